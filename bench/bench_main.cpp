@@ -0,0 +1,18 @@
+#include <benchmark/benchmark.h>
+
+#include "options.hpp"
+
+// kernels read Options (e.g. the random seed), so they run with the defaults
+int main(int argc, char **argv) {
+    RaytracerOptions options;
+    Options = &options;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    Options = nullptr;
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include "camera.h"
+#include "sphere.h"
+#include "util/math.hpp"
+#include "util/random.hpp"
+#include "util/transform.hpp"
+
+namespace {
+
+// inputs are generated up front and cycled through, a power of two so the
+// index is a mask and small enough to stay in L1
+constexpr int nInputs = 1024;
+
+// rays from the origin towards a sphere at z = -5; about hitPercent of them
+// hit it, the rest pass by within three radii
+std::vector<Ray> raysAt(const Body &s, int hitPercent) {
+    std::vector<Ray> rays;
+    for (int i = 0; i < nInputs; ++i) {
+        bool aimHit = Rand::random<Float>() * 100 < hitPercent;
+        Float r = aimHit ? 0.95 * s.radius * std::sqrt(Rand::random<Float>())
+                         : s.radius * (1.05 + 2 * Rand::random<Float>());
+        Float phi = 2 * Pi * Rand::random<Float>();
+        Point3f target = s.center + Vector3f(r * std::cos(phi), r * std::sin(phi), 0);
+        rays.emplace_back(Point3f(0, 0, 0), target - Point3f(0, 0, 0));
+    }
+    return rays;
+}
+
+Transform makeTransform(int kind) {
+    switch (kind) {
+    case 0:
+        return translate(Vector3f(1, -2, 3));
+    case 1:
+        return translate(Vector3f(1, -2, 3)) * rotate(30, Vector3f(1, 1, 0)) * scale(2, 2, 2);
+    default:
+        return lookAt(Point3f(13, 2, 3), Point3f(0, 0, 0), Vector3f(0, 1, 0));
+    }
+}
+
+std::vector<Point3f> randomPoints() {
+    std::vector<Point3f> p(nInputs);
+    for (auto &q : p)
+        q = Point3f(Rand::random<Float>(-10, 10), Rand::random<Float>(-10, 10), Rand::random<Float>(-10, 10));
+    return p;
+}
+
+} // namespace
+
+static void BM_SphereHit(benchmark::State &state) {
+    Rand::seed(1);
+    Body sphere{Point3f(0, 0, -5), 1};
+    std::vector<Ray> rays = raysAt(sphere, int(state.range(0)));
+
+    hit_record rec;
+    int64_t i = 0, hits = 0;
+    for (auto _ : state) {
+        bool h = hit(sphere, rays[i++ & (nInputs - 1)], interval(0.001, infinity), rec);
+        hits += h;
+        benchmark::DoNotOptimize(h);
+        benchmark::DoNotOptimize(rec);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hit%"] = state.iterations() ? 100.0 * hits / state.iterations() : 0.0;
+}
+BENCHMARK(BM_SphereHit)->ArgName("hit%")->Arg(0)->Arg(50)->Arg(100);
+
+static void BM_GetRay(benchmark::State &state) {
+    Rand::seed(1);
+    camera cam;
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 1200;
+    cam.lookfrom = Point3f(13, 2, 3);
+    cam.lookat = Point3f(0, 0, 0);
+    cam.vfov = 20;
+    cam.defocus_angle = Float(state.range(0));
+    cam.initialize();
+
+    int64_t i = 0;
+    for (auto _ : state) {
+        Point2f p(Float(i % cam.image_width) + 0.5, Float((i / cam.image_width) % cam.image_height) + 0.5);
+        benchmark::DoNotOptimize(cam.get_ray(p));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetRay)->ArgName("defocus")->Arg(0)->Arg(1);
+
+static void BM_RandomUnitVector(benchmark::State &state) {
+    Rand::seed(1);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(random_unit_vector<Float>());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomUnitVector);
+
+// kind 0: translation, 1: translate * rotate * scale, 2: lookAt
+static void BM_TransformPoint(benchmark::State &state) {
+    Rand::seed(1);
+    Transform t = makeTransform(int(state.range(0)));
+    std::vector<Point3f> points = randomPoints();
+
+    int64_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(t(points[i++ & (nInputs - 1)]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformPoint)->ArgName("kind")->DenseRange(0, 2);
+
+static void BM_TransformNormal(benchmark::State &state) {
+    Rand::seed(1);
+    Transform t = makeTransform(int(state.range(0)));
+    std::vector<Normal3f> normals(nInputs);
+    for (auto &n : normals)
+        n = Normal3f(random_unit_vector<Float>());
+
+    int64_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(t(normals[i++ & (nInputs - 1)]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformNormal)->ArgName("kind")->DenseRange(0, 2);
+
+static void BM_TransformRay(benchmark::State &state) {
+    Rand::seed(1);
+    Transform t = makeTransform(int(state.range(0)));
+    std::vector<Point3f> origins = randomPoints();
+
+    int64_t i = 0;
+    for (auto _ : state) {
+        int k = i++ & (nInputs - 1);
+        Float tMax = 100;
+        Ray r(origins[k], origins[(k + 1) & (nInputs - 1)] - Point3f(0, 0, 0));
+        benchmark::DoNotOptimize(t.applyInverse(r, &tMax));
+        benchmark::DoNotOptimize(tMax);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransformRay)->ArgName("kind")->DenseRange(0, 2);
+
+// affine matrices (the only kind scenes produce) or dense random ones
+static void BM_MatrixInverse(benchmark::State &state) {
+    Rand::seed(1);
+    std::vector<SquareMatrix<4>> matrices(64);
+    for (auto &m : matrices) {
+        if (state.range(0) == 0) {
+            m = (translate(Vector3f(Rand::random<Float>(), 1, 2)) *
+                 rotate(Rand::random<Float>(0, 360), Vector3f(0, 1, 1))).getMatrix();
+        } else {
+            for (int r = 0; r < 4; ++r)
+                for (int c = 0; c < 4; ++c)
+                    m[r][c] = Rand::random<Float>(-1, 1) + (r == c ? 4 : 0);
+        }
+    }
+
+    int64_t i = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(inverse(matrices[i++ & 63]));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MatrixInverse)->ArgName("dense")->Arg(0)->Arg(1);
@@ -0,0 +1,28 @@
+#include <benchmark/benchmark.h>
+
+#include "util/profiler.hpp"
+
+namespace {
+
+// an empty scope, i.e. what every PROFILE_SCOPE adds to the code around it;
+// clock -1 has profiling compiled in but switched off
+void ScopeCost(benchmark::State &state) {
+    int clock = int(state.range(0));
+    if (clock >= 0)
+        profiler.init(ProfileClock(clock));
+    profiler.profiling = clock >= 0;
+
+    for (auto _ : state) {
+        PROFILE_SCOPE("bench scope");
+        benchmark::ClobberMemory();
+    }
+    profiler.profiling = false;
+}
+BENCHMARK(ScopeCost)
+    ->ArgName("clock")
+    ->Arg(-1)
+    ->Arg(int(ProfileClock::Steady))
+    ->Arg(int(ProfileClock::Tsc))
+    ->Arg(int(ProfileClock::Coarse));
+
+} // namespace
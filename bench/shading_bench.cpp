@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "material.h"
+#include "render/display.hpp"
+#include "sphere.h"
+#include "util/random.hpp"
+
+namespace {
+
+constexpr int nInputs = 1024;
+
+// hits on a unit sphere seen from outside, with the incoming rays
+struct Hits {
+    std::vector<Ray> rays;
+    std::vector<hit_record> recs;
+};
+
+Hits sphereHits() {
+    Body sphere{Point3f(0, 0, 0), 1};
+    Hits h;
+    while (h.rays.size() < nInputs) {
+        Vector3f dir = random_unit_vector<Float>();
+        Ray r(Point3f(0, 0, 0) - 3 * dir + 0.5 * random_unit_vector<Float>(), dir);
+        hit_record rec;
+        if (!hit(sphere, r, interval(0.001, infinity), rec))
+            continue;
+        h.rays.push_back(r);
+        h.recs.push_back(rec);
+    }
+    return h;
+}
+
+void scatterLoop(benchmark::State &state, const material &m) {
+    Rand::seed(1);
+    Hits hits = sphereHits();
+
+    int64_t i = 0;
+    for (auto _ : state) {
+        int k = i++ & (nInputs - 1);
+        color attenuation;
+        Ray scattered;
+        bool ok = m.scatter(hits.rays[k], hits.recs[k], attenuation, scattered);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(scattered);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // namespace
+
+static void BM_LambertianScatter(benchmark::State &state) {
+    scatterLoop(state, lambertian(color(0.5, 0.5, 0.5)));
+}
+BENCHMARK(BM_LambertianScatter);
+
+// fuzz in percent
+static void BM_MetalScatter(benchmark::State &state) {
+    scatterLoop(state, metal(color(0.7, 0.6, 0.5), Float(state.range(0)) / 100));
+}
+BENCHMARK(BM_MetalScatter)->ArgName("fuzz%")->Arg(0)->Arg(30);
+
+// index of refraction times 100
+static void BM_DielectricScatter(benchmark::State &state) {
+    scatterLoop(state, dielectric(Float(state.range(0)) / 100));
+}
+BENCHMARK(BM_DielectricScatter)->ArgName("ior%")->Arg(133)->Arg(150)->Arg(240);
+
+// the per-pixel color encoding of the output path, which replaced write_color
+static void BM_DisplayTransform(benchmark::State &state) {
+    std::size_t n = std::size_t(state.range(0));
+    DisplayTransform display(1.f, ToneMap(state.range(1)), Transfer::SRGB);
+
+    Rand::seed(1);
+    std::vector<float> linear(3 * n), rgb(3 * n);
+    for (float &v : linear)
+        v = Rand::random<float>() * 4;
+
+    // apply() works in place; the copy back costs far less than the pow() of
+    // the sRGB curve, and pausing the timer every iteration would cost more
+    for (auto _ : state) {
+        std::copy(linear.begin(), linear.end(), rgb.begin());
+        display.apply(rgb.data(), n);
+        benchmark::DoNotOptimize(rgb.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    state.SetBytesProcessed(state.iterations() * n * 3 * sizeof(float));
+}
+BENCHMARK(BM_DisplayTransform)
+    ->ArgNames({"pixels", "tonemap"})
+    ->ArgsProduct({{1 << 10, 1 << 16}, {int(ToneMap::None), int(ToneMap::Reinhard), int(ToneMap::Aces)}});
@@ -0,0 +1,129 @@
+#include "scaling.hpp"
+#include "options.hpp"
+#include "render/render.hpp"
+#include "util/error.hpp"
+#include "util/json.hpp"
+#include "util/log.hpp"
+#include "util/parallel.hpp"
+#include "worlds/worlds.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <print>
+
+namespace {
+
+double mraysPerSecond(const RenderStats &s) {
+    return s.wallNs > 0 ? s.rays.totalRays() * 1e3 / s.wallNs : 0;
+}
+
+bool writeScaling(const std::vector<ScalingPoint> &points, const Scene &scene, const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    const camera &cam = scene.camera;
+    std::print(f, "{{\n  \"scene\": {},\n  \"width\": {},\n  \"height\": {},\n  \"spp\": {},\n  \"runs\": {},\n"
+               "  \"tile_size\": {},\n  \"hardware_concurrency\": {},\n  \"points\": [", jsonQuote(Options->scene),
+               cam.image_width, cam.image_height, cam.samples_per_pixel, Options->benchRuns, Options->tileSize,
+               std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        const ScalingPoint &p = points[i];
+        std::print(f, "{}\n    {{\"threads\": {}, \"wall_ms\": {:.3f}, \"mrays_per_s\": {:.4g}, \"speedup\": {:.4f}, "
+                   "\"efficiency\": {:.4f},\n     \"mean_idle_percent\": {:.2f}, \"max_idle_percent\": {:.2f}, "
+                   "\"idle_ms\": [", i ? "," : "", p.threads, p.best.wallNs / 1e6, mraysPerSecond(p.best),
+                   p.speedup, p.efficiency, 100 * p.meanIdle, 100 * p.maxIdle);
+        for (std::size_t t = 0; t < p.idleMs.size(); ++t)
+            std::print(f, "{}{:.3f}", t ? ", " : "", p.idleMs[t]);
+        std::print(f, "]}}");
+    }
+    std::print(f, "\n  ]\n}}\n");
+    if (fclose(f) != 0) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    LOG_VERBOSE("Wrote thread scaling results to {}", filename);
+    return true;
+}
+
+} // namespace
+
+std::vector<int> scalingThreadCounts(int maxThreads) {
+    std::vector<int> counts;
+    for (int n = 1; n < maxThreads; n *= 2)
+        counts.push_back(n);
+    counts.push_back(std::max(maxThreads, 1));
+    return counts;
+}
+
+ScalingPoint makeScalingPoint(int threads, const RenderStats &best, int64_t serialNs) {
+    ScalingPoint p;
+    p.threads = threads;
+    p.best = best;
+    p.speedup = best.wallNs > 0 ? double(serialNs) / best.wallNs : 0;
+    p.efficiency = p.speedup / threads;
+    for (int64_t busy : best.busyNs) {
+        int64_t idle = std::max<int64_t>(best.wallNs - busy, 0);
+        double fraction = best.wallNs > 0 ? double(idle) / best.wallNs : 0;
+        p.idleMs.push_back(idle / 1e6);
+        p.meanIdle += fraction / best.busyNs.size();
+        p.maxIdle = std::max(p.maxIdle, fraction);
+    }
+    return p;
+}
+
+std::vector<ScalingPoint> measureScaling(const Scene &scene) {
+    // adaptive tiles would cut the image finer for more threads, and the
+    // outputs only cost time outside the measurement
+    RaytracerOptions options = *Options;
+    options.adaptiveTiles = false;
+    options.writeOutput = false;
+    options.streamOutput = false;
+    options.heatmapFile.clear();
+    options.aovs.clear();
+    options.denoise = false;
+    options.checkpointFile.clear();
+    RaytracerOptions *saved = Options;
+    Options = &options;
+
+    std::vector<ScalingPoint> points;
+    for (int n : scalingThreadCounts(Options->nThreads)) {
+        // a fresh pool, so no worker of the last count is left spinning;
+        // only workers are pinned, so recreating it leaves this thread as it was
+        delete threadPool;
+        threadPool = new ThreadPool(n, Options->pinThreads);
+
+        RenderStats best;
+        for (int run = 0; run < Options->benchRuns; ++run) {
+            RenderStats stats = render(scene);
+            if (run == 0 || stats.wallNs < best.wallNs)
+                best = std::move(stats);
+        }
+        points.push_back(makeScalingPoint(n, best, points.empty() ? best.wallNs : points[0].best.wallNs));
+        LOG_VERBOSE("{} threads: {:.1f}ms, speedup {:.2f}", n, best.wallNs / 1e6, points.back().speedup);
+    }
+    // leave the pool as init() made it
+    delete threadPool;
+    threadPool = new ThreadPool(Options->nThreads, Options->pinThreads);
+
+    Options = saved;
+    return points;
+}
+
+int runScalingBenchmark(const std::string &filename) {
+    Scene scene = makeScene(Options->scene);
+    std::vector<ScalingPoint> points = measureScaling(scene);
+
+    std::println("{:>7} {:>10} {:>9} {:>8} {:>10} {:>10} {:>10}", "threads", "wall ms", "Mrays/s", "speedup",
+                 "efficiency", "mean idle", "max idle");
+    for (const ScalingPoint &p : points)
+        std::println("{:>7} {:>10.1f} {:>9.2f} {:>8.2f} {:>9.1f}% {:>9.1f}% {:>9.1f}%", p.threads,
+                     p.best.wallNs / 1e6, mraysPerSecond(p.best), p.speedup, 100 * p.efficiency,
+                     100 * p.meanIdle, 100 * p.maxIdle);
+    auto knee = std::find_if(points.begin(), points.end(),
+                             [](const ScalingPoint &p) { return p.efficiency < 0.8; });
+    if (knee != points.end())
+        std::println("efficiency falls below 80% at {} threads", knee->threads);
+
+    return writeScaling(points, scene, filename) ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "render/render.hpp"
+
+/*
+ * Thread scaling benchmark: renders --scene with 1, 2, 4, ... threads up to
+ * --threads, recreating the thread pool for every count, and reports the
+ * speedup over one thread, the parallel efficiency (speedup / threads) and
+ * how long each thread sat idle while the others were still tracing. Idle
+ * time that grows with the thread count points at load imbalance or
+ * contention rather than at the tracing itself.
+ *
+ * Every count renders the same --tile-size tiles, so only the number of
+ * threads changes, and writes no image, heatmap or AOVs.
+ */
+
+struct ScalingPoint {
+    int threads = 0;
+    RenderStats best;  // fastest of the runs
+    double speedup = 0, efficiency = 0;
+    std::vector<double> idleMs;        // per thread, of the fastest run
+    double meanIdle = 0, maxIdle = 0;  // fractions of the wall time
+};
+
+// 1, 2, 4, ... below maxThreads, then maxThreads itself
+std::vector<int> scalingThreadCounts(int maxThreads);
+
+// a point from the fastest render at threads threads and the wall time of one thread
+ScalingPoint makeScalingPoint(int threads, const RenderStats &best, int64_t serialNs);
+
+// renders scene Options->benchRuns times at every count up to Options->nThreads
+std::vector<ScalingPoint> measureScaling(const Scene &scene);
+
+// runs the benchmark and writes its JSON to filename; returns the process exit code
+int runScalingBenchmark(const std::string &filename);
@@ -0,0 +1,315 @@
+#include "scenesuite.hpp"
+#include "options.hpp"
+#include "util/error.hpp"
+#include "util/json.hpp"
+#include "util/log.hpp"
+#include <OpenImageIO/imageio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <print>
+#include <random>
+#include <system_error>
+
+#ifdef __linux__
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+using namespace OIIO;
+namespace fs = std::filesystem;
+
+namespace {
+
+// a scratch directory, removed with everything in it when this goes out of scope
+struct TempDir {
+    explicit TempDir(const std::string &prefix)
+    : path(fs::temp_directory_path() / std::format("{}-{:08x}", prefix, std::random_device{}())) {
+        fs::create_directories(path);
+    }
+    ~TempDir() {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    fs::path path;
+};
+
+// one render of a case in a child process
+struct Run {
+    bool ok = false;
+    double wallMs = 0, mraysPerSecond = 0, peakRssMiB = 0;
+};
+
+#ifdef __linux__
+Run runChild(const BenchCase &c, const fs::path &image, const fs::path &stats) {
+    std::vector<std::string> args = {
+        "raytracer",
+        "--scene", c.scene,
+        "--resolution", std::format("{}x{}", c.width, c.height),
+        "--spp", std::to_string(c.spp),
+        "--seed", std::to_string(c.seed),
+        "--threads", std::to_string(Options->nThreads),
+        "--output", image.string(),
+        "--stats-file", stats.string(),
+        "--log-level", "warning",
+    };
+    std::vector<char *> argv;
+    for (std::string &a : args)
+        argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    Run run;
+    pid_t pid;
+    if (int err = posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, argv.data(), environ); err != 0) {
+        error("Unable to start a render for {}: {}", c.name, errorString(err));
+        return run;
+    }
+    int status = 0;
+    rusage usage = {};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        error("Waiting for the render of {}: {}", c.name, errorString());
+        return run;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        error("The render of {} failed ({})", c.name,
+              WIFEXITED(status) ? std::format("exit code {}", WEXITSTATUS(status))
+                                : std::format("signal {}", WTERMSIG(status)));
+        return run;
+    }
+
+    JsonValue s = loadJson(stats.string());
+    run.ok = true;
+    run.wallMs = s.number("wall_ms", 0);
+    run.mraysPerSecond = s.number("mrays_per_s", 0);
+    run.peakRssMiB = usage.ru_maxrss / 1024.0;  // KiB on Linux
+    return run;
+}
+#else
+Run runChild(const BenchCase &c, const fs::path &, const fs::path &) {
+    error("The benchmark suite needs Linux to run {}", c.name);
+    return {};
+}
+#endif
+
+// RGB of an image file, empty if it cannot be read
+std::vector<float> readRgb(const std::string &filename, int &width, int &height) {
+    auto in = ImageInput::open(filename);
+    if (!in)
+        return {};
+    const ImageSpec &spec = in->spec();
+    width = spec.width;
+    height = spec.height;
+    int nc = spec.nchannels;
+
+    std::vector<float> raw(std::size_t(width) * height * nc);
+    if (!in->read_image(0, 0, 0, nc, TypeDesc::FLOAT, raw.data()))
+        return {};
+    std::vector<float> rgb(std::size_t(width) * height * 3);
+    for (std::size_t i = 0; i < std::size_t(width) * height; ++i)
+        for (int c = 0; c < 3; ++c)
+            rgb[i * 3 + c] = raw[i * nc + std::min(c, nc - 1)];
+    return rgb;
+}
+
+std::optional<double> meanSquaredError(const std::string &image, const std::string &reference) {
+    if (!fs::exists(reference)) {
+        warning("No reference image {}, rerun with --bench-update-references to store one", reference);
+        return {};
+    }
+    int w, h, rw, rh;
+    std::vector<float> a = readRgb(image, w, h), b = readRgb(reference, rw, rh);
+    if (a.empty() || b.empty()) {
+        error("Unable to compare {} with {}: {}", image, reference, geterror());
+        return {};
+    }
+    if (w != rw || h != rh) {
+        error("{} is {}x{}, its reference {} is {}x{}", image, w, h, reference, rw, rh);
+        return {};
+    }
+    double sum = 0;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        sum += double(a[i] - b[i]) * (a[i] - b[i]);
+    return sum / a.size();
+}
+
+} // namespace
+
+const std::vector<BenchCase> &benchCases() {
+    // small enough for the whole suite to take minutes on a CI machine
+    static const std::vector<BenchCase> cases = {
+        {"manyballs", "manyballs", 640, 360, 16, 1},
+        {"manyballs-large", "manyballs-large", 640, 360, 16, 1},
+        {"manyballs-huge", "manyballs-huge", 640, 360, 4, 1},
+        {"glassballs", "glassballs", 640, 360, 16, 1},
+    };
+    return cases;
+}
+
+int runSceneSuite() {
+    // a bad baseline is fatal, and errorFatal() does not unwind, so read it
+    // before there is a directory to clean up
+    std::vector<BenchResult> baseline;
+    if (!Options->benchBaseline.empty())
+        baseline = loadBenchResults(Options->benchBaseline);
+
+    TempDir tmp("raytracer-bench");
+    std::vector<BenchResult> results;
+    bool failed = false;
+    for (const BenchCase &c : benchCases()) {
+        BenchResult r;
+        r.c = c;
+        fs::path image = tmp.path / (c.name + ".exr");
+        double bestMs = 0;
+        for (int i = 0; i < Options->benchRuns; ++i) {
+            Run run = runChild(c, image, tmp.path / (c.name + ".json"));
+            if (!run.ok)
+                break;
+            r.wallMs.push_back(run.wallMs);
+            r.peakRssMiB = std::max(r.peakRssMiB, run.peakRssMiB);
+            if (i == 0 || run.wallMs < bestMs) {
+                bestMs = run.wallMs;
+                r.mraysPerSecond = run.mraysPerSecond;
+            }
+        }
+        r.ok = int(r.wallMs.size()) == Options->benchRuns;
+        failed |= !r.ok;
+
+        if (r.ok) {
+            fs::path reference = fs::path(Options->benchReferences) / (c.name + ".exr");
+            if (Options->benchUpdateReferences) {
+                std::error_code ec;
+                fs::create_directories(reference.parent_path(), ec);
+                if (!ec)
+                    fs::copy_file(image, reference, fs::copy_options::overwrite_existing, ec);
+                if (ec)
+                    error("Unable to store {}: {}", reference.string(), ec.message());
+                else
+                    LOG_VERBOSE("Stored {} as the reference for {}", reference.string(), c.name);
+            }
+            r.mse = meanSquaredError(image.string(), reference.string());
+            LOG_VERBOSE("{}: {:.1f}ms, {:.2f} Mrays/s, {:.1f} MiB peak", c.name, bestMs, r.mraysPerSecond,
+                        r.peakRssMiB);
+        }
+        results.push_back(std::move(r));
+    }
+
+    std::println("{:<18} {:>6} {:>10} {:>10} {:>10} {:>12}", "case", "runs", "best ms", "Mrays/s", "peak MiB", "mse");
+    for (const BenchResult &r : results) {
+        if (!r.ok) {
+            std::println("{:<18} failed", r.c.name);
+            continue;
+        }
+        std::println("{:<18} {:>6} {:>10.1f} {:>10.2f} {:>10.1f} {:>12}", r.c.name, r.wallMs.size(),
+                     *std::min_element(r.wallMs.begin(), r.wallMs.end()), r.mraysPerSecond, r.peakRssMiB,
+                     r.mse ? std::format("{:.3g}", *r.mse) : "-");
+    }
+    if (!writeBenchResults(results, Options->benchSuite))
+        failed = true;
+
+    if (!Options->benchBaseline.empty()) {
+        auto comparisons = compareResults(baseline, results, Options->benchTolerance);
+        std::println("\nagainst {} (tolerance {:.0f}%):", Options->benchBaseline, 100 * Options->benchTolerance);
+        std::println("{:<18} {:<12} {:>12} {:>12} {:>9}", "case", "metric", "baseline", "current", "change");
+        int regressions = 0;
+        for (const BenchComparison &c : comparisons) {
+            double change = c.baseline != 0 ? 100 * (c.current - c.baseline) / c.baseline : 0;
+            std::println("{:<18} {:<12} {:>12.4g} {:>12.4g} {:>8.1f}%{}", c.name, c.metric, c.baseline, c.current,
+                         change, c.regression ? "  REGRESSION" : "");
+            regressions += c.regression;
+        }
+        if (regressions > 0) {
+            error("{} regression{} against {}", regressions, regressions > 1 ? "s" : "", Options->benchBaseline);
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+std::vector<BenchComparison> compareResults(const std::vector<BenchResult> &baseline,
+                                            const std::vector<BenchResult> &current, double tolerance) {
+    // errors of images that match their reference are round-off; this keeps
+    // 0 -> 1e-12 from counting as an infinite relative change
+    constexpr double mseFloor = 1e-6;
+
+    std::vector<BenchComparison> out;
+    for (const BenchResult &cur : current) {
+        auto base = std::find_if(baseline.begin(), baseline.end(),
+                                 [&](const BenchResult &b) { return b.c.name == cur.c.name; });
+        if (base == baseline.end() || !base->ok || !cur.ok)
+            continue;
+
+        double baseMs = *std::min_element(base->wallMs.begin(), base->wallMs.end());
+        double curMs = *std::min_element(cur.wallMs.begin(), cur.wallMs.end());
+        out.push_back({cur.c.name, "wall_ms", baseMs, curMs, curMs > baseMs * (1 + tolerance)});
+        out.push_back({cur.c.name, "mrays_per_s", base->mraysPerSecond, cur.mraysPerSecond,
+                       cur.mraysPerSecond < base->mraysPerSecond * (1 - tolerance)});
+        out.push_back({cur.c.name, "peak_rss_mib", base->peakRssMiB, cur.peakRssMiB,
+                       cur.peakRssMiB > base->peakRssMiB * (1 + tolerance)});
+        if (base->mse && cur.mse)
+            out.push_back({cur.c.name, "mse", *base->mse, *cur.mse,
+                           *cur.mse > std::max(*base->mse, mseFloor) * (1 + tolerance)});
+    }
+    return out;
+}
+
+bool writeBenchResults(const std::vector<BenchResult> &results, const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    std::print(f, "{{\n  \"threads\": {},\n  \"cases\": [", Options->nThreads);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        std::print(f, "{}\n    {{\"name\": {}, \"scene\": {}, \"width\": {}, \"height\": {}, \"spp\": {}, "
+                   "\"seed\": {}, \"ok\": {},\n     \"wall_ms\": [", i ? "," : "", jsonQuote(r.c.name),
+                   jsonQuote(r.c.scene), r.c.width, r.c.height, r.c.spp, r.c.seed, r.ok);
+        for (std::size_t k = 0; k < r.wallMs.size(); ++k)
+            std::print(f, "{}{:.3f}", k ? ", " : "", r.wallMs[k]);
+        std::print(f, "], \"mrays_per_s\": {:.4f}, \"peak_rss_mib\": {:.2f}, \"mse\": {}}}", r.mraysPerSecond,
+                   r.peakRssMiB, r.mse ? std::format("{:.6g}", *r.mse) : "null");
+    }
+    std::print(f, "\n  ]\n}}\n");
+    if (fclose(f) != 0) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    LOG_VERBOSE("Wrote benchmark results to {}", filename);
+    return true;
+}
+
+std::vector<BenchResult> loadBenchResults(const std::string &filename) {
+    JsonValue doc = loadJson(filename);
+    const JsonValue *cases = doc.find("cases");
+    if (!cases || cases->type != JsonValue::Type::Array)
+        errorFatal("{}: no \"cases\" array, not a benchmark results file", filename);
+
+    std::vector<BenchResult> results;
+    for (const JsonValue &v : cases->items) {
+        BenchResult r;
+        r.c = {v.string("name"), v.string("scene"), int(v.number("width", 0)), int(v.number("height", 0)),
+               int(v.number("spp", 0)), unsigned(v.number("seed", 0))};
+        const JsonValue *ok = v.find("ok");
+        r.ok = ok && ok->boolean;
+        if (const JsonValue *ms = v.find("wall_ms"))
+            for (const JsonValue &t : ms->items)
+                r.wallMs.push_back(t.num);
+        r.ok = r.ok && !r.wallMs.empty();
+        r.mraysPerSecond = v.number("mrays_per_s", 0);
+        r.peakRssMiB = v.number("peak_rss_mib", 0);
+        if (const JsonValue *mse = v.find("mse"); mse && mse->isNumber())
+            r.mse = mse->num;
+        results.push_back(std::move(r));
+    }
+    return results;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/*
+ * End-to-end benchmark of whole renders. Every case renders a built-in
+ * scene at a fixed size, sample count and seed in a child process (this
+ * executable, run again with --stats-file), so each run starts cold and its
+ * peak RSS is its own. The results are written as JSON: wall time of the
+ * ray tracing, Mrays/s, peak RSS and the mean squared error against a
+ * stored reference image, which catches changes to the image itself.
+ *
+ * Given a baseline, i.e. the results of an earlier run, every metric is
+ * compared with a relative tolerance and any regression makes the run fail.
+ */
+struct BenchCase {
+    std::string name;
+    std::string scene;
+    int width, height, spp;
+    unsigned int seed;
+};
+
+struct BenchResult {
+    BenchCase c;
+    bool ok = false;
+    std::vector<double> wallMs;  // one per run
+    double mraysPerSecond = 0;   // of the fastest run
+    double peakRssMiB = 0;       // largest over the runs
+    std::optional<double> mse;   // none without a reference image
+};
+
+const std::vector<BenchCase> &benchCases();
+
+// runs the suite as Options->bench* say; returns the process exit code
+int runSceneSuite();
+
+// a baseline metric compared with the current one
+struct BenchComparison {
+    std::string name, metric;
+    double baseline, current;
+    bool regression;
+};
+
+// every metric of current that baseline also has, with tolerance as a
+// fraction of the baseline value
+std::vector<BenchComparison> compareResults(const std::vector<BenchResult> &baseline,
+                                            const std::vector<BenchResult> &current, double tolerance);
+
+bool writeBenchResults(const std::vector<BenchResult> &results, const std::string &filename);
+std::vector<BenchResult> loadBenchResults(const std::string &filename);
@@ -2,19 +2,30 @@
 #define CAMERA_H
 
 #include "hittable.h"
+#include "lights.hpp"
 #include "material.h"
 #include "sphere.h"
 #include "util/profiler.hpp"
+#include "util/stats.hpp"
 #include "util/vecmath.hpp"
 #include "util/timing.hpp"
 #include "util/log.hpp"
 #include "util/math.hpp"
+#include "util/sampling.hpp"
 #include <iostream>
 
+// first-hit data for AOV output; ray_color only fills it in when given one
+struct AovSample {
+    color albedo{0, 0, 0};
+    Normal3f normal{0, 0, 0};
+    Float depth = infinity;
+    int primId = -1;
+};
+
 struct camera {
     Float  aspect_ratio = 1.0;
     int    image_width = 100;
-    int    image_height;
+    int    image_height = 0;   // derived from aspect_ratio when left at 0
 
     int    samples_per_pixel = 10;
     Float  pixel_samples_scale;
@@ -46,7 +57,8 @@ struct camera {
 
     void initialize() {
         PROFILE_SCOPE("initialize");
-        image_height = std::max(int(image_width / aspect_ratio), 1);
+        if (image_height <= 0)
+            image_height = std::max(int(image_width / aspect_ratio), 1);
         center = Point3f(0, 0, 0);
         pixel_samples_scale = 1.0 / samples_per_pixel;
 
@@ -85,11 +97,16 @@ struct camera {
     int max_depth = 10;
 
     Ray get_ray(int i, int j) const {
-        PROFILE_SCOPE("get_ray");
         auto offset = sample_square();
+        return get_ray(Point2f(i + 0.5 + offset.x, j + 0.5 + offset.y));
+    }
+
+    // ray through continuous film position p, pixel (i, j) covers [i, i+1) x [j, j+1)
+    Ray get_ray(Point2f p) const {
+        PROFILE_SCOPE_DETAIL("get_ray");
         auto pixel_sample = pixel00_loc
-                            + ((i + offset.x) * pixel_delta_u)
-                            + ((j + offset.y) * pixel_delta_v);
+                            + ((p.x - 0.5) * pixel_delta_u)
+                            + ((p.y - 0.5) * pixel_delta_v);
         auto ray_origin = (defocus_angle <= 0) ? center : defocus_disk_sample();
         auto ray_dir = pixel_sample - ray_origin;
         return Ray(ray_origin, ray_dir);
@@ -99,12 +116,14 @@ struct camera {
         hit_record temp_rec;
         bool hit_anything = false;
         auto closest_so_far = ray_t.max;
-        DCHECK_EQ(spheres.centers.size(), spheres.materials.size());
+        DCHECK_EQ(spheres.centers.size(), spheres.materialIds.size());
+        STAT_TESTS(spheres.size());
 
         for (int i = 0; i < spheres.centers.size(); ++i) {
             auto sphere = spheres.centers[i];
             if (hit(spheres.centers[i], r, interval(ray_t.min, closest_so_far), temp_rec)) {
-                temp_rec.mat = spheres.materials[i];
+                temp_rec.mat = spheres.materials[spheres.materialIds[i]].get();
+                temp_rec.primId = i;
                 hit_anything = true;
                 closest_so_far = temp_rec.t;
                 rec = temp_rec;
@@ -114,32 +133,95 @@ struct camera {
         return hit_anything;
     }
 
-    color ray_color(const Ray &r0, const Spheres &world) const {
+    color ray_color(const Ray &r0, const Spheres &world, const EnvironmentLight *env = nullptr,
+                    AovSample *aov = nullptr) const {
         PROFILE_SCOPE("ray_color");
         Ray r = r0;
         color throughput(1.0, 1.0, 1.0);
+        color L(0.0, 0.0, 0.0);
+
+        // density the current ray direction was sampled with, zero after a delta lobe
+        Float scatterPdf = 0;
+        bool escaped = false;
+
+        int depth = 0;
+        for (; depth < max_depth; ++depth) {
+            if (depth == 0)
+                STAT_ADD(cameraRays, 1);
+            else
+                STAT_ADD(secondaryRays, 1);
 
-        for (int depth = 0; depth < max_depth; ++depth) {
             hit_record rec;
-            auto s = sample_start("ray_color::hit");
-            if (!camera_hit(r, interval(0.001, infinity), rec, world))
+            bool hit;
+            {
+                PROFILE_SCOPE_DETAIL("ray_color::hit");
+                hit = camera_hit(r, interval(0.001, infinity), rec, world);
+            }
+            if (!hit) {
+                escaped = true;
                 break;
-            sample_end(s.release());
+            }
+
+            if (aov && depth == 0) {
+                aov->albedo = rec.mat->surfaceAlbedo();
+                aov->normal = rec.normal;
+                aov->depth = rec.t * length(r.d);
+                aov->primId = rec.primId;
+            }
+
+            if (env)
+                L += throughput * sample_light(rec, world, *env);
 
             color attenuation;
-            auto s2 = sample_start("ray_color::scatter");
-            if (!rec.mat->scatter(r, rec, attenuation, r))
-                return color(0.0, 0.0, 0.0);
-            sample_end(s2.release());
+            bool scattered;
+            {
+                PROFILE_SCOPE_DETAIL("ray_color::scatter");
+                scattered = rec.mat->scatter(r, rec, attenuation, r);
+            }
+            if (!scattered) {
+                STAT_PATH_DEPTH(depth + 1);
+                return L;
+            }
 
             throughput *= attenuation;
+            scatterPdf = rec.mat->pdf(rec, r.d);
+        }
+        // surfaces hit, a path that escapes at depth d hit d of them
+        STAT_PATH_DEPTH(depth);
+
+        if (!env) {
+            Vector3f unit_direction = normalize(r.d);
+            Float t = 0.5*(unit_direction.y + 1.0);
+            color lerp = (1.f - t)*color(1.0, 1.0, 1.0) + t*color(0.3, 0.7, 1.0);
+
+            return lerp * throughput;
         }
 
-        Vector3f unit_direction = normalize(r.d);
-        Float t = 0.5*(unit_direction.y + 1.0);
-        color lerp = (1.f - t)*color(1.0, 1.0, 1.0) + t*color(0.3, 0.7, 1.0);
+        if (!escaped)
+            return L;
+
+        Float w = (scatterPdf > 0) ? powerHeuristic(1, scatterPdf, 1, env->pdf(r.d)) : 1;
+        return L + throughput * env->Le(r.d) * w;
+    }
+
+    // next event estimation towards the environment, MIS weighted against scatter()
+    color sample_light(const hit_record &rec, const Spheres &world, const EnvironmentLight &env) const {
+        PROFILE_SCOPE_DETAIL("ray_color::sample_light");
+        auto ls = env.sample(Point2f(Rand::random<Float>(), Rand::random<Float>()));
+        if (!ls)
+            return color(0, 0, 0);
+
+        Float matPdf = rec.mat->pdf(rec, ls->wi);
+        if (matPdf == 0)
+            return color(0, 0, 0);
+
+        hit_record occluder;
+        STAT_ADD(shadowRays, 1);
+        if (camera_hit(Ray(rec.p, ls->wi), interval(0.001, infinity), occluder, world))
+            return color(0, 0, 0);
 
-        return lerp * throughput;
+        Float w = powerHeuristic(1, ls->pdf, 1, matPdf);
+        return rec.mat->f(rec, ls->wi) * ls->L * (absDot(ls->wi, rec.normal) * w / ls->pdf);
     }
 
     Vector3f sample_square() const {
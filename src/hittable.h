@@ -12,7 +12,9 @@ class material;
 struct hit_record {
     Point3f p;
     Normal3f normal;
-    std::shared_ptr<material> mat;
+    // non-owning: copying a shared_ptr here bumped a refcount shared by every thread on every hit
+    const material *mat = nullptr;
+    int primId = -1;
     Float t;
     bool front_face;
 
@@ -0,0 +1,94 @@
+#include "lights.hpp"
+#include "util/log.hpp"
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+#include <OpenImageIO/imageio.h>
+
+using namespace OIIO;
+
+Point2f equirectFromDirection(const Vector3f &dir) {
+    Vector3f w = normalize(dir);
+    Float theta = safeACos(w.y);
+    Float phi = std::atan2(w.z, w.x);
+    if (phi < 0) phi += 2 * Pi;
+    return Point2f(phi * Inv2Pi, theta * InvPi);
+}
+
+Vector3f directionFromEquirect(Point2f uv) {
+    Float phi = uv[0] * 2 * Pi;
+    Float theta = uv[1] * Pi;
+    Float sinTheta = std::sin(theta);
+    return Vector3f(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+}
+
+static Float luminance(const float *rgb) {
+    return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+}
+
+EnvironmentLight::EnvironmentLight(int width, int height, std::vector<float> texels, Float scale)
+: width(width), height(height), texels(std::move(texels)), scale(scale) {
+    PROFILE_SCOPE("EnvironmentLight::init");
+    CHECK_EQ(this->texels.size(), std::size_t(width) * height * 3);
+
+    std::vector<Float> func(std::size_t(width) * height);
+    parallelFor(0, height, [&](int64_t y) {
+        Float sinTheta = std::sin(Pi * (y + 0.5) / height);
+        for (int x = 0; x < width; ++x) {
+            std::size_t i = std::size_t(y) * width + x;
+            func[i] = luminance(&this->texels[i * 3]) * sinTheta;
+        }
+    }, 16);
+
+    distrib = PiecewiseConstant2D(func, width, height);
+}
+
+std::shared_ptr<EnvironmentLight> EnvironmentLight::load(const std::string &filename, Float scale) {
+    PROFILE_SCOPE("EnvironmentLight::load");
+
+    auto in = ImageInput::open(filename);
+    if (!in)
+        errorFatal("{}: unable to open environment map: {}", filename, OIIO::geterror());
+
+    const ImageSpec &spec = in->spec();
+    int w = spec.width, h = spec.height, nc = spec.nchannels;
+
+    std::vector<float> raw(std::size_t(w) * h * nc);
+    if (!in->read_image(0, 0, 0, nc, TypeDesc::FLOAT, raw.data()))
+        errorFatal("{}: unable to read environment map: {}", filename, in->geterror());
+    in->close();
+
+    std::vector<float> rgb(std::size_t(w) * h * 3);
+    for (std::size_t i = 0; i < std::size_t(w) * h; ++i)
+        for (int c = 0; c < 3; ++c)
+            rgb[i * 3 + c] = raw[i * nc + std::min(c, nc - 1)];
+
+    LOG_VERBOSE("Loaded environment map {} ({}x{}, {} channels)", filename, w, h, nc);
+    return std::make_shared<EnvironmentLight>(w, h, std::move(rgb), scale);
+}
+
+color EnvironmentLight::Le(const Vector3f &dir) const {
+    return lookup(equirectFromDirection(dir));
+}
+
+std::optional<EnvironmentLight::LightSample> EnvironmentLight::sample(Point2f u) const {
+    Float mapPdf;
+    Point2f uv = distrib.sample(u, &mapPdf);
+    if (mapPdf == 0)
+        return {};
+
+    Float sinTheta = std::sin(uv[1] * Pi);
+    if (sinTheta == 0)
+        return {};
+
+    // change of variables from the unit square to solid angle
+    Float pdf = mapPdf / (2 * Pi * Pi * sinTheta);
+    return LightSample{directionFromEquirect(uv), lookup(uv), pdf};
+}
+
+Float EnvironmentLight::pdf(const Vector3f &dir) const {
+    Point2f uv = equirectFromDirection(dir);
+    Float sinTheta = std::sin(uv[1] * Pi);
+    if (sinTheta == 0)
+        return 0;
+    return distrib.pdf(uv) / (2 * Pi * Pi * sinTheta);
+}
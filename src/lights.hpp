@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "color.h"
+#include "raytracer.hpp"
+#include "util/sampling.hpp"
+#include "util/vecmath.hpp"
+
+/*
+ * Infinitely distant light read from an equirectangular (lat-long) HDR image.
+ * y is up: v = 0 is the +y pole, u wraps around the horizon starting at +x.
+ *
+ * Directions are importance sampled proportional to texel luminance times
+ * sin(theta), which accounts for the shrinking solid angle of texels near
+ * the poles.
+ */
+class EnvironmentLight {
+public:
+    struct LightSample {
+        Vector3f wi;
+        color L;
+        Float pdf;
+    };
+
+    EnvironmentLight(int width, int height, std::vector<float> texels, Float scale = 1);
+
+    static std::shared_ptr<EnvironmentLight> load(const std::string &filename, Float scale = 1);
+
+    color Le(const Vector3f &dir) const;
+    std::optional<LightSample> sample(Point2f u) const;
+    Float pdf(const Vector3f &dir) const;
+
+private:
+    color lookup(Point2f uv) const {
+        int x = clamp(int(uv[0] * width), 0, width - 1);
+        int y = clamp(int(uv[1] * height), 0, height - 1);
+        const float *t = &texels[(std::size_t(y) * width + x) * 3];
+        return scale * color(t[0], t[1], t[2]);
+    }
+
+    int width, height;
+    // tightly packed RGB rows, so a miss costs a single cache line
+    std::vector<float> texels;
+    Float scale;
+    PiecewiseConstant2D distrib;
+};
+
+Point2f equirectFromDirection(const Vector3f &dir);
+Vector3f directionFromEquirect(Point2f uv);
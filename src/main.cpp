@@ -1,6 +1,10 @@
+#include "benchmark/scaling.hpp"
+#include "benchmark/scenesuite.hpp"
 #include "options.hpp"
+#include "raytracer.hpp"
 #include "render/render.hpp"
 #include "util/math.hpp"
+#include "worlds/binscene.hpp"
 #include "worlds/worlds.hpp"
 #include "util/log.hpp"
 #include "util/profiler.hpp"
@@ -8,16 +12,28 @@
 
 using namespace OIIO;
 
-int main() {
+int main(int argc, char *argv[]) {
+    init(argc, argv);
     LOG_VERBOSE("Starting raytracing:");
-    init();
-    auto s = sample_start("main");
+    int status = 0;
+    {
+        PROFILE_SCOPE("main");
+        if (!Options->benchSuite.empty())
+            status = runSceneSuite();
+        else if (!Options->benchScaling.empty())
+            status = runScalingBenchmark(Options->benchScaling);
+        else if (!Options->writeScene.empty())
+            writeBinaryScene(loadScene(Options->scene), Options->writeScene);
+        else {
+            RenderStats stats = render(makeScene(Options->scene));
+            if (!Options->statsFile.empty() && !writeRenderStats(stats, Options->statsFile))
+                status = 1;
+        }
+    }
 
-    render(manyBalls());
-
-    profiler.print(true);
-    sample_end(s.release());
+    profiler.print(true, Options->profileThreads);
+    cleanup();
     LOG_VERBOSE("Finished render succesfully, shutting down logging\n\n******************************************************\n\n");
 
-    return 0;
+    return status;
 }
@@ -6,6 +6,18 @@
 #include "util/vecmath.hpp"
 #include "color.h"
 #include "raytracer.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+// parameters of a built-in material, as stored in binary scene files
+struct MaterialDesc {
+    enum class Type : uint32_t {Lambertian, Metal, Dielectric};
+    Type type;
+    color albedo{1, 1, 1};
+    Float fuzz = 0;
+    Float ior = 1;
+};
 
 struct material {
     virtual ~material() = default;
@@ -16,6 +28,29 @@ struct material {
                          Ray &scattered) const {
         return false;
     }
+
+    /*
+     * BSDF value and the density `scatter` samples wi with. Materials with
+     * only delta lobes (metal, glass) keep the zero defaults, which tells
+     * ray_color not to sample lights at their surfaces.
+     */
+    virtual color f(const hit_record &rec, const Vector3f &wi) const {
+        return color(0, 0, 0);
+    }
+
+    virtual Float pdf(const hit_record &rec, const Vector3f &wi) const {
+        return 0;
+    }
+
+    // surface color for the albedo AOV
+    virtual color surfaceAlbedo() const {
+        return color(1, 1, 1);
+    }
+
+    // empty for materials that cannot be written to a scene file
+    virtual std::optional<MaterialDesc> describe() const {
+        return {};
+    }
 };
 
 class lambertian : public material {
@@ -24,7 +59,7 @@ public:
 
     bool scatter(const Ray &r_in, const hit_record &rec, color &attenuation, Ray &scattered)
     const override {
-        PROFILE_SCOPE("lambertian::scatter");
+        PROFILE_SCOPE_DETAIL("lambertian::scatter");
         Vector3f scatter_direction = Vector3f(rec.normal) + random_unit_vector<Float>();
 
         if (scatter_direction.near_zero())
@@ -35,6 +70,22 @@ public:
         return true;
     }
 
+    color f(const hit_record &rec, const Vector3f &wi) const override {
+        return albedo * InvPi;
+    }
+
+    // normal + random_unit_vector() is cosine distributed about the normal
+    Float pdf(const hit_record &rec, const Vector3f &wi) const override {
+        Float cosTheta = dot(normalize(wi), rec.normal);
+        return cosTheta > 0 ? cosTheta * InvPi : 0;
+    }
+
+    color surfaceAlbedo() const override { return albedo; }
+
+    std::optional<MaterialDesc> describe() const override {
+        return MaterialDesc{MaterialDesc::Type::Lambertian, albedo};
+    }
+
 private:
     color albedo;
 };
@@ -45,7 +96,7 @@ public:
 
     bool scatter(const Ray &r_in, const hit_record &rec, color &attenuation, Ray &scattered)
     const override {
-        PROFILE_SCOPE("metal::scatter");
+        PROFILE_SCOPE_DETAIL("metal::scatter");
         Vector3f reflected = reflect(normalize(r_in.d), rec.normal);
         reflected = reflected + (fuzz * random_unit_vector<Float>());
         scattered = Ray(rec.p, reflected);
@@ -53,6 +104,12 @@ public:
         return (dot(scattered.d, rec.normal) > 0);
     }
 
+    color surfaceAlbedo() const override { return albedo; }
+
+    std::optional<MaterialDesc> describe() const override {
+        return MaterialDesc{MaterialDesc::Type::Metal, albedo, fuzz};
+    }
+
 private:
     color albedo;
     Float fuzz;
@@ -65,7 +122,7 @@ public:
 
     bool scatter(const Ray &r_in, const hit_record &rec, color &attenuation, Ray &scattered)
     const override {
-        PROFILE_SCOPE("dielectric::scatter");
+        PROFILE_SCOPE_DETAIL("dielectric::scatter");
         attenuation = color(1.0, 1.0, 1.0);
         Float ri = rec.front_face ? (1.0/refraction_index) : refraction_index;
 
@@ -84,6 +141,10 @@ public:
         return true;
     }
 
+    std::optional<MaterialDesc> describe() const override {
+        return MaterialDesc{MaterialDesc::Type::Dielectric, color(1, 1, 1), 0, refraction_index};
+    }
+
 private:
     Float refraction_index;
 
@@ -94,4 +155,13 @@ private:
     }
 };
 
+inline std::shared_ptr<material> makeMaterial(const MaterialDesc &desc) {
+    switch (desc.type) {
+    case MaterialDesc::Type::Lambertian: return std::make_shared<lambertian>(desc.albedo);
+    case MaterialDesc::Type::Metal:      return std::make_shared<metal>(desc.albedo, desc.fuzz);
+    case MaterialDesc::Type::Dielectric: return std::make_shared<dielectric>(desc.ior);
+    }
+    return nullptr;
+}
+
 #endif
@@ -0,0 +1,278 @@
+#include "options.hpp"
+#include "worlds/worlds.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <print>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct BadValue {
+    std::string message;
+};
+
+template <typename T>
+T parseNumber(const std::string &value) {
+    T result{};
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || end != value.data() + value.size())
+        throw BadValue{"\"" + value + "\" is not a valid number"};
+    return result;
+}
+
+template <typename T>
+T parseInRange(const std::string &value, T lo, T hi) {
+    T v = parseNumber<T>(value);
+    if (v < lo || v > hi)
+        throw BadValue{std::format("{} is out of range [{}, {}]", value, lo, hi)};
+    return v;
+}
+
+template <typename E>
+E parseEnum(const std::string &value, std::initializer_list<std::pair<const char *, E>> names) {
+    std::string expected;
+    for (const auto &[name, e] : names) {
+        if (value == name)
+            return e;
+        expected += (expected.empty() ? "" : ", ") + std::string(name);
+    }
+    throw BadValue{"\"" + value + "\" is not one of " + expected};
+}
+
+struct Option {
+    const char *name;
+    const char *arg;  // nullptr for flags
+    const char *help;
+    std::function<void(RaytracerOptions &, const std::string &)> set;
+};
+
+const std::vector<Option> &optionTable() {
+    using O = RaytracerOptions;
+    static const std::vector<Option> table = {
+        {"scene", "NAME", "built-in scene (see below), text or binary scene file",
+         [](O &o, const std::string &v) { o.scene = v; }},
+        {"write-scene", "FILE", "write the scene as a binary scene file and exit",
+         [](O &o, const std::string &v) { o.writeScene = v; }},
+        {"threads", "N", "worker threads, including the main thread",
+         [](O &o, const std::string &v) { o.nThreads = parseInRange(v, 1, 4096); }},
+        {"seed", "N", "random seed",
+         [](O &o, const std::string &v) { o.seed = parseNumber<unsigned>(v); }},
+        {"spp", "N", "samples per pixel",
+         [](O &o, const std::string &v) { o.spp = parseInRange(v, 1, 1 << 20); }},
+        {"resolution", "WxH", "image size in pixels",
+         [](O &o, const std::string &v) {
+             auto x = v.find('x');
+             if (x == std::string::npos)
+                 throw BadValue{"\"" + v + "\" is not of the form WxH"};
+             o.width = parseInRange(v.substr(0, x), 1, 1 << 16);
+             o.height = parseInRange(v.substr(x + 1), 1, 1 << 16);
+         }},
+        {"max-depth", "N", "maximum path length",
+         [](O &o, const std::string &v) { o.maxDepth = parseInRange(v, 1, 1024); }},
+        {"output", "FILE", "output image (default image.exr)",
+         [](O &o, const std::string &v) { o.outFile = v; }},
+        {"log-level", "LEVEL", "verbose, warning, error, debug or fatal",
+         [](O &o, const std::string &v) {
+             o.logLevel = logLevelFromString(v);
+             if (o.logLevel == LogLevel::Invalid)
+                 throw BadValue{"\"" + v + "\" is not a log level"};
+         }},
+        {"log-file", "NAME", "also log to ../logs/NAME.log",
+         [](O &o, const std::string &v) { o.logFile = v; }},
+        {"profile", nullptr, "print a profile at exit",
+         [](O &o, const std::string &) { o.profiling = true; }},
+        {"profile-clock", "CLOCK", "steady, tsc (cycle counter) or coarse (~1-4ms resolution)",
+         [](O &o, const std::string &v) {
+             o.profileClock = parseEnum<ProfileClock>(v, {{"steady", ProfileClock::Steady},
+                                                          {"tsc", ProfileClock::Tsc},
+                                                          {"coarse", ProfileClock::Coarse}});
+         }},
+        {"profile-counters", nullptr, "add IPC, cache and branch miss rates of tiles and render phases",
+         [](O &o, const std::string &) { o.profiling = o.profileCounters = true; }},
+        {"trace", "FILE", "write a Chrome/Perfetto trace of tiles, passes and I/O",
+         [](O &o, const std::string &v) { o.traceFile = v; }},
+        {"heatmap", "FILE", "write render time per pixel as a false-color image, and the slowest tiles to a .csv",
+         [](O &o, const std::string &v) { o.heatmapFile = v; }},
+        {"profile-threads", nullptr, "print a profile per thread as well",
+         [](O &o, const std::string &) { o.profiling = o.profileThreads = true; }},
+        {"tile-size", "N", "render tile size in pixels",
+         [](O &o, const std::string &v) { o.tileSize = parseInRange(v, 1, 4096); }},
+        {"adaptive-tiles", "on|off", "split the last tiles of a pass for load balance",
+         [](O &o, const std::string &v) {
+             o.adaptiveTiles = parseEnum<bool>(v, {{"on", true}, {"off", false}});
+         }},
+        {"tile-order", "ORDER", "rowmajor, hilbert or spiral",
+         [](O &o, const std::string &v) {
+             o.tileOrder = parseEnum<TileOrder>(v, {{"rowmajor", TileOrder::RowMajor},
+                                                    {"hilbert", TileOrder::Hilbert},
+                                                    {"spiral", TileOrder::Spiral}});
+         }},
+        {"mode", "MODE", "final or progressive",
+         [](O &o, const std::string &v) {
+             o.renderMode = parseEnum<RenderMode>(v, {{"final", RenderMode::Final},
+                                                      {"progressive", RenderMode::Progressive}});
+         }},
+        {"pass-spp", "N", "samples per pixel per progressive pass",
+         [](O &o, const std::string &v) { o.passSpp = parseInRange(v, 1, 1 << 20); }},
+        {"time-budget", "SECONDS", "stop progressive renders after this long",
+         [](O &o, const std::string &v) { o.timeBudget = parseInRange(v, 0.f, 1e7f); }},
+        {"target-noise", "ERROR", "stop progressive renders at this relative error",
+         [](O &o, const std::string &v) { o.targetNoise = parseInRange(v, 0.f, 1.f); }},
+        {"checkpoint", "FILE", "write checkpoints to FILE",
+         [](O &o, const std::string &v) { o.checkpointFile = v; }},
+        {"checkpoint-interval", "SECONDS", "time between checkpoints",
+         [](O &o, const std::string &v) { o.checkpointInterval = parseInRange(v, 0.f, 1e7f); }},
+        {"resume", "FILE", "continue from a checkpoint",
+         [](O &o, const std::string &v) { o.resumeFile = v; }},
+        {"filter", "FILTER", "box, gaussian, mitchell or blackman-harris",
+         [](O &o, const std::string &v) {
+             o.filter = parseEnum<FilterType>(v, {{"box", FilterType::Box},
+                                                  {"gaussian", FilterType::Gaussian},
+                                                  {"mitchell", FilterType::Mitchell},
+                                                  {"blackman-harris", FilterType::BlackmanHarris}});
+         }},
+        {"filter-radius", "PIXELS", "filter radius, 0 for the filter's default",
+         [](O &o, const std::string &v) { o.filterRadius = parseInRange(v, 0.f, 16.f); }},
+        {"stream", nullptr, "write a tiled EXR while rendering",
+         [](O &o, const std::string &) { o.streamOutput = true; }},
+        {"half", nullptr, "write half floats",
+         [](O &o, const std::string &) { o.halfFloat = true; }},
+        {"compression", "CODEC", "none, zip, piz or dwaa",
+         [](O &o, const std::string &v) {
+             o.compression = parseEnum<Compression>(v, {{"none", Compression::None},
+                                                        {"zip", Compression::Zip},
+                                                        {"piz", Compression::Piz},
+                                                        {"dwaa", Compression::Dwaa}});
+         }},
+        {"channels", "CHANNELS", "output channels, any of RGBA",
+         [](O &o, const std::string &v) { o.outChannels = v; }},
+        {"exposure", "STOPS", "exposure adjustment before tone mapping",
+         [](O &o, const std::string &v) { o.exposure = parseInRange(v, -64.f, 64.f); }},
+        {"tonemap", "OPERATOR", "none, clamp, reinhard or aces",
+         [](O &o, const std::string &v) {
+             o.toneMap = parseEnum<ToneMap>(v, {{"none", ToneMap::None},
+                                                {"clamp", ToneMap::Clamp},
+                                                {"reinhard", ToneMap::Reinhard},
+                                                {"aces", ToneMap::Aces}});
+         }},
+        {"transfer", "CURVE", "linear, gamma2 or srgb",
+         [](O &o, const std::string &v) {
+             o.transfer = parseEnum<Transfer>(v, {{"linear", Transfer::Linear},
+                                                  {"gamma2", Transfer::Gamma2},
+                                                  {"srgb", Transfer::SRGB}});
+         }},
+        {"aovs", "LIST", "albedo,normal,depth,primid,samples,time",
+         [](O &o, const std::string &v) { o.aovs = v; }},
+        {"denoise", nullptr, "denoise the final image",
+         [](O &o, const std::string &) { o.denoise = true; }},
+        {"env-map", "FILE", "equirectangular environment map",
+         [](O &o, const std::string &v) { o.envMap = v; }},
+        {"env-map-scale", "SCALE", "environment map intensity",
+         [](O &o, const std::string &v) { o.envMapScale = parseInRange(v, 0.f, 1e6f); }},
+        {"stats-file", "FILE", "write render time, ray counts and per-thread busy time as JSON",
+         [](O &o, const std::string &v) { o.statsFile = v; }},
+        {"bench-suite", "FILE", "render the benchmark scenes and write the results as JSON",
+         [](O &o, const std::string &v) { o.benchSuite = v; }},
+        {"bench-baseline", "FILE", "compare --bench-suite results with FILE, exit 1 on regressions",
+         [](O &o, const std::string &v) { o.benchBaseline = v; }},
+        {"bench-tolerance", "FRACTION", "relative change that counts as a regression (default 0.05)",
+         [](O &o, const std::string &v) { o.benchTolerance = parseInRange(v, 0.f, 10.f); }},
+        {"bench-runs", "N", "renders per benchmark scene, the fastest counts (default 3)",
+         [](O &o, const std::string &v) { o.benchRuns = parseInRange(v, 1, 100); }},
+        {"bench-references", "DIR", "reference images for the benchmark error (default bench/references)",
+         [](O &o, const std::string &v) { o.benchReferences = v; }},
+        {"bench-update-references", nullptr, "store the benchmark images as the new references",
+         [](O &o, const std::string &) { o.benchUpdateReferences = true; }},
+        {"bench-scaling", "FILE", "render --scene at 1, 2, 4, ... up to --threads threads, write the scaling as JSON",
+         [](O &o, const std::string &v) { o.benchScaling = v; }},
+        {"pin-threads", nullptr, "bind every worker thread to one CPU",
+         [](O &o, const std::string &) { o.pinThreads = true; }},
+        {"numa", "POLICY", "none, interleave or replicate",
+         [](O &o, const std::string &v) {
+             o.numaPolicy = parseEnum<NumaPolicy>(v, {{"none", NumaPolicy::None},
+                                                      {"interleave", NumaPolicy::Interleave},
+                                                      {"replicate", NumaPolicy::Replicate}});
+         }},
+    };
+    return table;
+}
+
+void printUsage(const char *program) {
+    std::println("Usage: {} [options]\n", program);
+    for (const Option &o : optionTable()) {
+        std::string flag = std::string("--") + o.name + (o.arg ? std::string(" ") + o.arg : "");
+        std::println("  {:<30} {}", flag, o.help);
+    }
+    std::println("  {:<30} {}", "-o FILE", "same as --output");
+    std::println("  {:<30} {}", "-h, --help", "show this message");
+
+    std::println("\nScenes:");
+    for (const std::string &name : sceneNames())
+        std::println("  {}", name);
+}
+
+[[noreturn]] void usageError(const char *program, const std::string &message) {
+    std::println(stderr, "{}: {}", program, message);
+    std::println(stderr, "Try '{} --help' for more information.", program);
+    std::exit(2);
+}
+
+} // namespace
+
+void parseCommandLine(int argc, char *argv[], RaytracerOptions &options) {
+    const char *program = argc > 0 ? argv[0] : "raytracer";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(program);
+            std::exit(0);
+        }
+        if (arg == "-o")
+            arg = "--output";
+        if (arg.rfind("--", 0) != 0)
+            usageError(program, "unexpected argument \"" + arg + "\"");
+
+        // --name value and --name=value
+        std::string name = arg.substr(2), value;
+        bool inlineValue = false;
+        if (auto eq = name.find('='); eq != std::string::npos) {
+            value = name.substr(eq + 1);
+            name = name.substr(0, eq);
+            inlineValue = true;
+        }
+
+        auto it = std::find_if(optionTable().begin(), optionTable().end(),
+                               [&](const Option &o) { return name == o.name; });
+        if (it == optionTable().end())
+            usageError(program, "unknown option --" + name);
+
+        if (!it->arg && inlineValue)
+            usageError(program, "--" + name + " does not take a value");
+        if (it->arg && !inlineValue) {
+            if (i + 1 >= argc)
+                usageError(program, "--" + name + " needs a value");
+            value = argv[++i];
+        }
+
+        try {
+            it->set(options, value);
+        } catch (const BadValue &e) {
+            usageError(program, "--" + name + ": " + e.message);
+        }
+    }
+
+    if (!sceneExists(options.scene))
+        usageError(program, "unknown scene \"" + options.scene + "\"");
+    if (options.streamOutput && options.renderMode == RenderMode::Progressive)
+        usageError(program, "--stream cannot be combined with --mode progressive");
+    if (options.benchSuite.empty() && (!options.benchBaseline.empty() || options.benchUpdateReferences))
+        usageError(program, "--bench-baseline and --bench-update-references need --bench-suite");
+    if (!options.benchSuite.empty() && !options.benchScaling.empty())
+        usageError(program, "--bench-suite cannot be combined with --bench-scaling");
+}
@@ -3,12 +3,74 @@
 #include "util/log.hpp"
 #include <thread>
 
+enum class TileOrder {RowMajor, Hilbert, Spiral};
+enum class NumaPolicy {None, Interleave, Replicate};
+enum class RenderMode {Final, Progressive};
+enum class Compression {None, Zip, Piz, Dwaa};
+enum class ToneMap {None, Clamp, Reinhard, Aces};
+enum class Transfer {Linear, Gamma2, SRGB};
+enum class ProfileClock {Steady, Tsc, Coarse};
+enum class FilterType {Box, Gaussian, Mitchell, BlackmanHarris};
+
 struct RaytracerOptions {
+    std::string scene = "manyballs";
+    std::string writeScene = "";       // convert scene to a binary scene file instead of rendering
+    // camera overrides, 0 keeps the scene's own setting
+    int spp = 0;
+    int width = 0, height = 0;
+    int maxDepth = 0;
+
     unsigned int seed = 0xDEADBEEF;
     int nThreads = std::thread::hardware_concurrency();
     LogLevel logLevel = LogLevel::Verbose;
     std::string logFile = "";
     bool profiling = false;
+    bool profileThreads = false;       // also print one profile per thread
+    ProfileClock profileClock = ProfileClock::Steady;
+    bool profileCounters = false;      // hardware counters in selected scopes
+    std::string traceFile = "";        // Chrome trace JSON of tiles, passes and I/O
+    std::string heatmapFile = "";      // false-color render time per pixel, plus a CSV of tiles
+    std::string statsFile = "";        // JSON summary of the render: time, rays, per-thread busy time
+
+    // scene benchmark suite, run instead of a render when benchSuite is set
+    std::string benchSuite = "";       // results JSON
+    std::string benchBaseline = "";    // earlier results to compare against
+    float benchTolerance = 0.05f;      // relative change counted as a regression
+    int benchRuns = 3;                 // renders per case, the fastest counts
+    std::string benchReferences = "bench/references";
+    bool benchUpdateReferences = false;
+    std::string benchScaling = "";     // JSON of a render at 1, 2, 4, ... --threads threads
+
+    std::string envMap = "";
+    float envMapScale = 1.f;
+    int tileSize = 32;
+    TileOrder tileOrder = TileOrder::Hilbert;
+    bool adaptiveTiles = true;
+    bool pinThreads = false;
+    NumaPolicy numaPolicy = NumaPolicy::None;
+    FilterType filter = FilterType::Box;
+    float filterRadius = 0.f;          // pixels, 0 for the filter's default
+    RenderMode renderMode = RenderMode::Final;
+    int passSpp = 4;           // samples per pixel added by each progressive pass
+    float timeBudget = 0.f;    // seconds, 0 for none
+    float targetNoise = 0.f;   // relative standard error to stop at, 0 for none
+    bool streamOutput = false; // write a tiled EXR while rendering (final mode only)
+    std::string outFile = "image.exr";
+    bool writeOutput = true;           // false renders for the time alone, as --bench-scaling does
+    std::string outChannels = "RGB"; // any of R, G, B, A, in file order
+    bool halfFloat = false;
+    Compression compression = Compression::Zip;
+    float exposure = 0.f;              // stops
+    ToneMap toneMap = ToneMap::Clamp;
+    Transfer transfer = Transfer::Gamma2;
+    std::string aovs = "";             // e.g. "albedo,normal,depth,primid,samples,time"
+    bool denoise = false;
+    std::string checkpointFile = "";   // empty for no checkpoints
+    float checkpointInterval = 300.f;  // seconds between checkpoints
+    std::string resumeFile = "";       // checkpoint to continue from
 };
 
 extern RaytracerOptions *Options;
+
+// fills options from argv; prints usage and exits on --help or invalid arguments
+void parseCommandLine(int argc, char *argv[], RaytracerOptions &options);
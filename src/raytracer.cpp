@@ -1,13 +1,37 @@
 #include "raytracer.hpp"
 #include "options.hpp"
+#include "util/error.hpp"
 #include "util/log.hpp"
+#include "util/parallel.hpp"
 #include "util/profiler.hpp"
+#include "util/trace.hpp"
+#include <OpenImageIO/imageio.h>
 
 RaytracerOptions* Options = nullptr;
 
-void init() {
+void init(int argc, char *argv[]) {
     Options = new RaytracerOptions();
+    parseCommandLine(argc, argv, *Options);
     initLogging();
-    if (Options->profiling)
-        profiler.init();
+    if (Options->profiling) {
+#ifdef NO_PROFILING
+        warning("Built without profiling (ENABLE_PROFILING=OFF), --profile has no effect");
+#endif
+        profiler.init(Options->profileClock, Options->profileCounters);
+    }
+    // before the pool, so workers can name their tracks
+    if (!Options->traceFile.empty())
+        tracer.init();
+    threadPool = new ThreadPool(Options->nThreads, Options->pinThreads);
+
+    // OpenEXR compresses blocks of scanlines/tiles in parallel on its own threads
+    OIIO::attribute("threads", Options->nThreads);
+    OIIO::attribute("exr_threads", Options->nThreads);
+}
+
+void cleanup() {
+    if (tracer.enabled)
+        tracer.write(Options->traceFile);
+    delete threadPool;
+    threadPool = nullptr;
 }
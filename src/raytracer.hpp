@@ -32,5 +32,5 @@ using Normal3i = Normal3<int>;
 
 using Bounds3f = Bounds3<Float>;
 
-void init();
+void init(int argc, char *argv[]);
 void cleanup();
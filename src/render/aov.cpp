@@ -0,0 +1,126 @@
+#include "aov.hpp"
+#include "util/error.hpp"
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+#include <limits>
+#include <sstream>
+
+using namespace OIIO;
+
+namespace {
+
+struct AovInfo {
+    unsigned aov;
+    const char *name;
+    std::vector<std::string> channels;
+};
+
+const std::vector<AovInfo> &aovInfo() {
+    static const std::vector<AovInfo> info = {
+        {AovFilm::Albedo,  "albedo",  {"R", "G", "B"}},
+        {AovFilm::Normal,  "normal",  {"X", "Y", "Z"}},
+        {AovFilm::Depth,   "depth",   {"Z"}},
+        {AovFilm::PrimId,  "primid",  {"id"}},
+        {AovFilm::Samples, "samples", {"Y"}},
+        {AovFilm::Time,    "time",    {"Y"}},
+    };
+    return info;
+}
+
+} // namespace
+
+unsigned AovFilm::parse(const std::string &list) {
+    unsigned aovs = 0;
+    std::stringstream ss(list);
+    std::string name;
+
+    while (std::getline(ss, name, ',')) {
+        if (name.empty())
+            continue;
+        auto it = std::find_if(aovInfo().begin(), aovInfo().end(),
+                               [&](const AovInfo &i) { return name == i.name; });
+        if (it == aovInfo().end())
+            errorFatal("Unknown AOV \"{}\", expected albedo, normal, depth, primid, samples or time", name);
+        aovs |= it->aov;
+    }
+    return aovs;
+}
+
+AovFilm::AovFilm(int width, int height, unsigned aovs, unsigned outputs)
+: w(width), h(height), aovs(aovs), outputs(outputs), pixels(std::size_t(width) * height, Pixel{}) {}
+
+std::vector<ImageSpec> AovFilm::specs(const ImageSpec &image) const {
+    std::vector<ImageSpec> result;
+    for (const AovInfo &info : aovInfo()) {
+        if (!writes(info.aov))
+            continue;
+
+        TypeDesc type = (info.aov == PrimId) ? TypeDesc::UINT32 : TypeDesc::FLOAT;
+        ImageSpec spec(w, h, int(info.channels.size()), type);
+        spec.channelnames = info.channels;
+        spec.attribute("name", info.name);
+        spec.attribute("compression", image.get_string_attribute("compression", "zip"));
+        result.push_back(spec);
+    }
+    return result;
+}
+
+std::vector<float> AovFilm::resolve(unsigned aov, const Film &film) const {
+    int nc = (aov == Albedo || aov == Normal) ? 3 : 1;
+    std::vector<float> out(std::size_t(w) * h * nc);
+
+    parallelFor(0, h, [&](int64_t y) {
+        for (int x = 0; x < w; ++x) {
+            std::size_t i = std::size_t(y) * w + x;
+            const Pixel &p = pixels[i];
+            float *o = &out[i * nc];
+            switch (aov) {
+            case Albedo:
+            case Normal: {
+                const float *v = (aov == Albedo) ? p.albedo : p.normal;
+                for (int c = 0; c < 3; ++c)
+                    o[c] = p.samples > 0 ? v[c] / p.samples : 0.f;
+                break;
+            }
+            case Depth:
+                o[0] = p.hits > 0 ? p.depth / p.hits : std::numeric_limits<float>::infinity();
+                break;
+            case Samples:
+                // from the film, so samples restored from a checkpoint count too
+                o[0] = float(film.samples(x, int(y)));
+                break;
+            case Time:
+                o[0] = p.timeNs;
+                break;
+            }
+        }
+    }, 16);
+    return out;
+}
+
+bool AovFilm::write(ImageOutput &out, const std::string &filename, const Film &film) const {
+    PROFILE_SCOPE("AovFilm::write");
+    std::vector<ImageSpec> aovSpecs = specs(out.spec());
+
+    int part = 0;
+    for (const AovInfo &info : aovInfo()) {
+        if (!writes(info.aov))
+            continue;
+        if (!out.open(filename, aovSpecs[part++], ImageOutput::AppendSubimage))
+            return false;
+
+        if (info.aov == PrimId) {
+            std::vector<uint32_t> ids(pixels.size());
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    ids[std::size_t(y) * w + x] = primId(x, y);
+            if (!out.write_image(TypeDesc::UINT32, ids.data()))
+                return false;
+        } else {
+            std::vector<float> data = resolve(info.aov, film);
+            if (!out.write_image(TypeDesc::FLOAT, data.data()))
+                return false;
+        }
+    }
+    return true;
+}
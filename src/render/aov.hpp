@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/imageio.h>
+
+#include "camera.h"
+#include "film.hpp"
+
+/*
+ * Auxiliary output buffers, written as extra parts of the output EXR:
+ * first-hit albedo, shading normal and depth, the primitive id seen by the
+ * pixel's first sample (stored as id + 1, 0 for background), samples taken
+ * and nanoseconds spent per pixel.
+ *
+ * Albedo, normal and depth are averaged over a pixel's own samples, not
+ * filtered, so every pixel belongs to exactly one render tile and the
+ * thread rendering it writes it without locks. Nothing here exists unless
+ * an AOV (or the denoiser, for its guides) was asked for; render() then
+ * hands ray_color no AovSample at all.
+ */
+class AovFilm {
+public:
+    enum : unsigned {
+        Albedo  = 1 << 0,
+        Normal  = 1 << 1,
+        Depth   = 1 << 2,
+        PrimId  = 1 << 3,
+        Samples = 1 << 4,
+        Time    = 1 << 5,
+    };
+
+    // comma separated names, e.g. "albedo,normal"; errorFatal on unknown ones
+    static unsigned parse(const std::string &list);
+
+    // gathers aovs, and writes the subset in outputs (all of them by default);
+    // the rest are only there for other stages, e.g. denoiser guides
+    AovFilm(int width, int height, unsigned aovs, unsigned outputs = ~0u);
+
+    bool wants(unsigned aov) const { return (aovs & aov) != 0; }
+    bool writes(unsigned aov) const { return (aovs & outputs & aov) != 0; }
+    bool needsHits() const { return wants(Albedo | Normal | Depth | PrimId); }
+
+    void addSample(int x, int y, const AovSample &s) {
+        Pixel &p = pixels[std::size_t(y) * w + x];
+        if (p.samples == 0)
+            p.primId = s.primId;
+        p.samples += 1;
+        if (s.primId < 0)
+            return;
+
+        p.hits += 1;
+        p.albedo[0] += float(s.albedo.x);
+        p.albedo[1] += float(s.albedo.y);
+        p.albedo[2] += float(s.albedo.z);
+        p.normal[0] += float(s.normal.x);
+        p.normal[1] += float(s.normal.y);
+        p.normal[2] += float(s.normal.z);
+        p.depth += float(s.depth);
+    }
+
+    void addTime(int x, int y, int64_t ns) { pixels[std::size_t(y) * w + x].timeNs += float(ns); }
+
+    // the PrimId AOV value of pixel (x, y): first sample's id + 1, 0 for background
+    uint32_t primId(int x, int y) const { return uint32_t(pixels[std::size_t(y) * w + x].primId + 1); }
+
+    // one spec per written AOV, named after it, in the order write() writes them
+    std::vector<OIIO::ImageSpec> specs(const OIIO::ImageSpec &image) const;
+
+    // full-frame buffer of one gathered AOV other than PrimId, 3 or 1 floats per pixel
+    std::vector<float> resolve(unsigned aov, const Film &film) const;
+
+    // appends every written AOV as a subimage of out, which has the main image
+    // open and was opened with the specs above following it
+    bool write(OIIO::ImageOutput &out, const std::string &filename, const Film &film) const;
+
+private:
+    struct Pixel {
+        float albedo[3] = {};
+        float normal[3] = {};
+        float depth = 0, hits = 0, samples = 0, timeNs = 0;
+        int32_t primId = -1;
+    };
+
+    int w, h;
+    unsigned aovs, outputs;
+    std::vector<Pixel> pixels;
+};
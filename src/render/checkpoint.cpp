@@ -0,0 +1,133 @@
+#include "checkpoint.hpp"
+#include "options.hpp"
+#include "util/error.hpp"
+#include "util/log.hpp"
+#include "util/profiler.hpp"
+#include "util/timing.hpp"
+#include "util/trace.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <fcntl.h>
+#endif
+
+namespace {
+
+constexpr char magic[4] = {'R', 'T', 'C', 'K'};
+constexpr uint32_t version = 1;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t width, height;
+    uint32_t seed;
+    int32_t samplesDone;
+    uint64_t pixelBytes;  // sizeof(Film::Pixel), guards against layout changes
+};
+
+struct FileCloser {
+    void operator()(FILE *f) const { fclose(f); }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+bool writeFile(const std::string &filename, const Header &header, const std::vector<Film::Pixel> &pixels) {
+    FilePtr f(fopen(filename.c_str(), "wb"));
+    if (!f)
+        return false;
+
+    if (fwrite(&header, sizeof(header), 1, f.get()) != 1 ||
+        fwrite(pixels.data(), sizeof(Film::Pixel), pixels.size(), f.get()) != pixels.size() ||
+        fflush(f.get()) != 0)
+        return false;
+#if defined(__unix__) || defined(__APPLE__)
+    // the rename must not reach the disk before the data does
+    int fd = fileno(f.get());
+#ifdef __APPLE__
+    // fsync() only reaches the drive's cache on macOS; fall back to it where
+    // the file system does not support F_FULLFSYNC
+    if (fcntl(fd, F_FULLFSYNC) == 0)
+        return true;
+#endif
+    if (fsync(fd) != 0)
+        return false;
+#endif
+    return true;
+}
+
+} // namespace
+
+void Checkpointer::save(const Film &film, int samplesDone) {
+    wait();
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.width = film.width();
+    header.height = film.height();
+    header.seed = Options->seed;
+    header.samplesDone = samplesDone;
+    header.pixelBytes = sizeof(Film::Pixel);
+
+    writer = std::thread([this, header, pixels = film.snapshot()]() {
+        PROFILE_SCOPE("Checkpointer::write");
+        tracer.nameThread("checkpoint writer");
+        TraceScope trace("write checkpoint", "io");
+        trace.arg("spp", header.samplesDone);
+        auto start = curr_time();
+        std::string tmp = filename + ".tmp";
+
+        std::error_code ec;
+        if (!writeFile(tmp, header, pixels)) {
+            error("{}: unable to write checkpoint: {}", tmp, errorString());
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+        std::filesystem::rename(tmp, filename, ec);
+        if (ec) {
+            error("{}: unable to replace checkpoint: {}", filename, ec.message());
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+        LOG_VERBOSE("Checkpoint at {} spp written to {} in {}ms", header.samplesDone, filename,
+                    diff_time<milliseconds>(start, curr_time()).count());
+    });
+}
+
+void Checkpointer::wait() {
+    if (writer.joinable())
+        writer.join();
+}
+
+int loadCheckpoint(const std::string &filename, Film &film) {
+    PROFILE_SCOPE("loadCheckpoint");
+    FilePtr f(fopen(filename.c_str(), "rb"));
+    if (!f)
+        errorFatal("{}: {}", filename, errorString());
+
+    Header header;
+    if (fread(&header, sizeof(header), 1, f.get()) != 1 ||
+        std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+        errorFatal("{}: not a checkpoint file", filename);
+    if (header.version != version || header.pixelBytes != sizeof(Film::Pixel))
+        errorFatal("{}: checkpoint version {} is not supported", filename, header.version);
+    if (header.width != film.width() || header.height != film.height())
+        errorFatal("{}: checkpoint is {}x{}, the image is {}x{}", filename,
+                   header.width, header.height, film.width(), film.height());
+    if (header.seed != Options->seed)
+        errorFatal("{}: checkpoint was rendered with seed {}, not {}", filename, header.seed, Options->seed);
+
+    std::vector<Film::Pixel> pixels(std::size_t(film.width()) * film.height());
+    if (fread(pixels.data(), sizeof(Film::Pixel), pixels.size(), f.get()) != pixels.size())
+        errorFatal("{}: checkpoint is truncated", filename);
+
+    film.restore(pixels);
+    return header.samplesDone;
+}
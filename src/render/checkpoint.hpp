@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <thread>
+
+#include "film.hpp"
+
+/*
+ * Render checkpoints: the film's accumulated sums and sample counts plus
+ * the number of samples per pixel taken so far. Samples are seeded from
+ * the pixel and sample index alone, so that count is the whole sampler
+ * state, and a resumed render continues to the same image an uninterrupted
+ * one produces.
+ *
+ * Files are written to "<name>.tmp" and renamed over the old checkpoint, so
+ * a node killed mid-write leaves the previous checkpoint intact.
+ */
+class Checkpointer {
+public:
+    explicit Checkpointer(std::string filename) : filename(std::move(filename)) {}
+    ~Checkpointer() { wait(); }
+
+    Checkpointer(const Checkpointer &) = delete;
+    Checkpointer &operator=(const Checkpointer &) = delete;
+
+    // copies the film now and writes it on a background thread; must be
+    // called between passes, when every pixel has samplesDone samples
+    void save(const Film &film, int samplesDone);
+
+    // blocks until the last save is on disk
+    void wait();
+
+private:
+    std::string filename;
+    std::thread writer;
+};
+
+// restores film from a checkpoint written for the same image size and seed
+// and returns the samples per pixel it holds; errorFatal on any mismatch
+int loadCheckpoint(const std::string &filename, Film &film);
@@ -0,0 +1,132 @@
+#include "costmap.hpp"
+#include "util/error.hpp"
+#include "util/log.hpp"
+#include "util/profiler.hpp"
+#include <OpenImageIO/imageio.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <numeric>
+#include <print>
+
+using namespace OIIO;
+
+namespace {
+
+// matplotlib's inferno at nine evenly spaced points, perceptually uniform
+// and still readable when printed in grey
+constexpr uint8_t inferno[9][3] = {
+    {0x00, 0x00, 0x04}, {0x1f, 0x0c, 0x48}, {0x55, 0x0f, 0x6d}, {0x88, 0x22, 0x6a}, {0xba, 0x36, 0x55},
+    {0xe3, 0x59, 0x33}, {0xf9, 0x8e, 0x09}, {0xf9, 0xcb, 0x35}, {0xfc, 0xff, 0xa4},
+};
+
+void colormap(float t, uint8_t rgb[3]) {
+    t = std::clamp(t, 0.f, 1.f) * 8;
+    int i = std::min(int(t), 7);
+    float f = t - i;
+    for (int c = 0; c < 3; ++c)
+        rgb[c] = uint8_t(std::lround(inferno[i][c] + f * (inferno[i + 1][c] - inferno[i][c])));
+}
+
+struct FileCloser {
+    void operator()(FILE *f) const { fclose(f); }
+};
+using FilePtr = std::unique_ptr<FILE, FileCloser>;
+
+} // namespace
+
+CostMap::CostMap(int width, int height, std::vector<Bounds2<int>> tiles)
+: w(width), h(height), tiles(std::move(tiles)), pixelNs(std::size_t(width) * height, 0.f),
+  tileNs(this->tiles.size(), 0), tileRays(this->tiles.size(), 0) {}
+
+std::string CostMap::csvFilename(const std::string &filename) {
+    return std::filesystem::path(filename).replace_extension(".csv").string();
+}
+
+bool CostMap::write(const std::string &filename) const {
+    PROFILE_SCOPE("CostMap::write");
+    return writeImage(filename) && writeCsv(csvFilename(filename));
+}
+
+std::vector<uint8_t> CostMap::heatmap(float *fullScaleNs) const {
+    // a few pathological pixels would otherwise squash everything else into black
+    std::vector<float> sorted(pixelNs);
+    std::size_t p99 = sorted.size() * 99 / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+    float scale = sorted[p99] > 0 ? 1.f / sorted[p99] : 0.f;
+    if (fullScaleNs)
+        *fullScaleNs = sorted[p99];
+
+    std::vector<uint8_t> rgb(pixelNs.size() * 3);
+    for (std::size_t i = 0; i < pixelNs.size(); ++i)
+        colormap(pixelNs[i] * scale, &rgb[3 * i]);
+    return rgb;
+}
+
+bool CostMap::writeImage(const std::string &filename) const {
+    float fullScaleNs = 0;
+    std::vector<uint8_t> rgb = heatmap(&fullScaleNs);
+
+    std::unique_ptr<ImageOutput> out = ImageOutput::create(filename);
+    if (!out) {
+        error("{}: {}", filename, geterror());
+        return false;
+    }
+    ImageSpec spec(w, h, 3, TypeDesc::UINT8);
+    spec.attribute("ImageDescription",
+                   std::format("render time per pixel, brightest (pale yellow) = {:.1f}us or more", fullScaleNs / 1e3));
+    if (!out->open(filename, spec) || !out->write_image(TypeDesc::UINT8, rgb.data()) || !out->close()) {
+        error("{}: {}", filename, out->geterror());
+        return false;
+    }
+    LOG_VERBOSE("Wrote render cost heatmap {} (full scale {:.1f}us per pixel)", filename, fullScaleNs / 1e3);
+    return true;
+}
+
+bool CostMap::writeCsv(const std::string &filename) const {
+    std::vector<std::size_t> order(tiles.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return tileNs[a] > tileNs[b]; });
+    int64_t totalNs = std::accumulate(tileNs.begin(), tileNs.end(), int64_t(0));
+    int64_t medianNs = order.empty() ? 0 : tileNs[order[order.size() / 2]];
+
+    FilePtr f(fopen(filename.c_str(), "w"));
+    if (!f) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    // without ray statistics every tile would claim zero rays
+#ifdef NO_STATS
+    std::print(f.get(), "rank,x,y,width,height,ms,percent,vs_median\n");
+#else
+    std::print(f.get(), "rank,x,y,width,height,ms,percent,vs_median,rays,ns_per_ray\n");
+#endif
+    for (std::size_t r = 0; r < order.size(); ++r) {
+        std::size_t i = order[r];
+        const Bounds2<int> &t = tiles[i];
+        std::print(f.get(), "{},{},{},{},{},{:.3f},{:.2f},{:.2f}", r + 1, t.pMin.x, t.pMin.y,
+                   t.pMax.x - t.pMin.x, t.pMax.y - t.pMin.y, tileNs[i] / 1e6,
+                   totalNs > 0 ? 100.0 * tileNs[i] / totalNs : 0.0,
+                   medianNs > 0 ? double(tileNs[i]) / medianNs : 0.0);
+#ifndef NO_STATS
+        std::print(f.get(), ",{},{:.1f}", tileRays[i], tileRays[i] > 0 ? double(tileNs[i]) / tileRays[i] : 0.0);
+#endif
+        std::print(f.get(), "\n");
+    }
+    if (fclose(f.release()) != 0) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+
+    for (std::size_t r = 0; r < std::min<std::size_t>(order.size(), 3); ++r) {
+        const Bounds2<int> &t = tiles[order[r]];
+        LOG_VERBOSE("slowest tile {}: ({}, {})-({}, {}) {:.1f}ms, {:.1f}x the median", r + 1, t.pMin.x, t.pMin.y,
+                    t.pMax.x, t.pMax.y, tileNs[order[r]] / 1e6,
+                    medianNs > 0 ? double(tileNs[order[r]]) / medianNs : 0.0);
+    }
+    LOG_VERBOSE("Wrote {} tiles, slowest first, to {}", order.size(), filename);
+    return true;
+}
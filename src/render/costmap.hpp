@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/vecmath.hpp"
+
+/*
+ * Where render time goes: nanoseconds per pixel and per tile (and rays per
+ * tile when built with ray statistics), summed over all passes. write()
+ * turns the pixel times into a false-color image, black for free pixels
+ * through red to pale yellow for the 99th percentile and anything slower,
+ * and lists the tiles slowest first in a CSV next to it.
+ *
+ * Like the film, every pixel and tile is written only by the thread
+ * rendering its tile, so nothing is locked.
+ */
+class CostMap {
+public:
+    CostMap(int width, int height, std::vector<Bounds2<int>> tiles);
+
+    void addPixel(int x, int y, int64_t ns) { pixelNs[std::size_t(y) * w + x] += float(ns); }
+    void addTile(std::size_t tile, int64_t ns, uint64_t rays) {
+        tileNs[tile] += ns;
+        tileRays[tile] += rays;
+    }
+
+    // the heatmap to filename, in any format OIIO writes 8-bit RGB to, and
+    // the tiles to filename with a .csv extension
+    bool write(const std::string &filename) const;
+
+    // "<file>.csv" for "<file>.png"
+    static std::string csvFilename(const std::string &filename);
+
+    // 8-bit RGB per pixel, fullScaleNs is set to the 99th percentile time
+    // that maps to the brightest color
+    std::vector<uint8_t> heatmap(float *fullScaleNs = nullptr) const;
+    // one row per tile, slowest first
+    bool writeCsv(const std::string &filename) const;
+
+private:
+    bool writeImage(const std::string &filename) const;
+
+    int w, h;
+    std::vector<Bounds2<int>> tiles;
+    std::vector<float> pixelNs;
+    std::vector<int64_t> tileNs;
+    std::vector<uint64_t> tileRays;
+};
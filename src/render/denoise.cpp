@@ -0,0 +1,109 @@
+#include "denoise.hpp"
+#include "util/check.h"
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+constexpr int tileSize = 64;
+
+// keeps black and missing albedo from blowing up the demodulated irradiance
+constexpr float albedoEpsilon = 1e-3f;
+
+struct Planes {
+    Planes(std::size_t n, int count) : data(count, std::vector<float>(n)) {}
+    float *operator[](int i) { return data[i].data(); }
+    const float *operator[](int i) const { return data[i].data(); }
+
+    std::vector<std::vector<float>> data;
+};
+
+} // namespace
+
+std::vector<float> denoise(int width, int height, const std::vector<float> &rgb,
+                           const std::vector<float> &albedo, const std::vector<float> &normal,
+                           const DenoiseSettings &settings) {
+    PROFILE_SCOPE_COUNTERS("denoise");
+    std::size_t n = std::size_t(width) * height;
+    CHECK_EQ(rgb.size(), 3 * n);
+    CHECK_EQ(albedo.size(), 3 * n);
+    CHECK_EQ(normal.size(), 3 * n);
+
+    // planar copies: irradiance, albedo, normal, irradiance luminance
+    Planes irr(n, 3), alb(n, 3), nrm(n, 3), lum(n, 1);
+    parallelFor(0, height, [&](int64_t y) {
+        for (int64_t i = y * width; i < (y + 1) * width; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                float a = std::max(albedo[3 * i + c], albedoEpsilon);
+                alb[c][i] = a;
+                irr[c][i] = rgb[3 * i + c] / a;
+                nrm[c][i] = normal[3 * i + c];
+            }
+            lum[0][i] = 0.2126f * irr[0][i] + 0.7152f * irr[1][i] + 0.0722f * irr[2][i];
+        }
+    }, 16);
+
+    const int r = settings.radius;
+    const float invSpatial = 1 / (2 * settings.sigmaSpatial * settings.sigmaSpatial);
+    const float invAlbedo = 1 / (2 * settings.sigmaAlbedo * settings.sigmaAlbedo);
+    const float invNormal = 1 / settings.sigmaNormal;
+    const float invColor = 1 / (2 * settings.sigmaColor * settings.sigmaColor);
+
+    std::vector<float> out(3 * n);
+    Bounds2<int> image(Point2<int>(0, 0), Point2<int>(width, height));
+
+    parallelFor2D(image, tileSize, [&](Bounds2<int> tile) {
+        int tw = tile.pMax.x - tile.pMin.x, th = tile.pMax.y - tile.pMin.y;
+        static thread_local std::vector<float> acc;
+        acc.assign(std::size_t(tw) * th * 4, 0.f);
+        float *sumR = acc.data(), *sumG = sumR + tw * th, *sumB = sumG + tw * th, *sumW = sumB + tw * th;
+
+        for (int dy = -r; dy <= r; ++dy) {
+            for (int dx = -r; dx <= r; ++dx) {
+                // the center tap gets weight 1 outright: with zero normals (misses)
+                // its computed weight would be exp(-1 / sigmaNormal)
+                bool center = dx == 0 && dy == 0;
+                float spatial = (dx * dx + dy * dy) * invSpatial;
+                // only pixels whose tap lands inside the image
+                int x0 = std::max(tile.pMin.x, -dx), x1 = std::min(tile.pMax.x, width - dx);
+                int y0 = std::max(tile.pMin.y, -dy), y1 = std::min(tile.pMax.y, height - dy);
+
+                for (int y = y0; y < y1; ++y) {
+                    std::size_t p = std::size_t(y) * width, q = std::size_t(y + dy) * width + dx;
+                    std::size_t t = std::size_t(y - tile.pMin.y) * tw - tile.pMin.x;
+
+                    for (int x = x0; x < x1; ++x) {
+                        float da = (alb[0][p + x] - alb[0][q + x]) * (alb[0][p + x] - alb[0][q + x]) +
+                                   (alb[1][p + x] - alb[1][q + x]) * (alb[1][p + x] - alb[1][q + x]) +
+                                   (alb[2][p + x] - alb[2][q + x]) * (alb[2][p + x] - alb[2][q + x]);
+                        float cosN = nrm[0][p + x] * nrm[0][q + x] + nrm[1][p + x] * nrm[1][q + x] +
+                                     nrm[2][p + x] * nrm[2][q + x];
+                        float lp = lum[0][p + x], lq = lum[0][q + x];
+                        float dc = (lp - lq) * (lp - lq) / ((lp + lq) * (lp + lq) + 1e-4f);
+
+                        float w = center ? 1.f : std::exp(-spatial - da * invAlbedo -
+                                                          std::max(1.f - cosN, 0.f) * invNormal - dc * invColor);
+                        sumR[t + x] += w * irr[0][q + x];
+                        sumG[t + x] += w * irr[1][q + x];
+                        sumB[t + x] += w * irr[2][q + x];
+                        sumW[t + x] += w;
+                    }
+                }
+            }
+        }
+
+        for (int y = tile.pMin.y; y < tile.pMax.y; ++y)
+            for (int x = tile.pMin.x; x < tile.pMax.x; ++x) {
+                std::size_t i = std::size_t(y) * width + x, t = std::size_t(y - tile.pMin.y) * tw + (x - tile.pMin.x);
+                // the center tap has weight 1, so sumW >= 1
+                out[3 * i + 0] = sumR[t] / sumW[t] * alb[0][i];
+                out[3 * i + 1] = sumG[t] / sumW[t] * alb[1][i];
+                out[3 * i + 2] = sumB[t] / sumW[t] * alb[2][i];
+            }
+    });
+
+    return out;
+}
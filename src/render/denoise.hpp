@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+/*
+ * Joint cross-bilateral denoiser for the linear radiance of a finished
+ * frame, guided by the first-hit albedo and normal AOVs.
+ *
+ * Radiance is divided by albedo first, so texture detail is carried by the
+ * guide and only the much smoother irradiance is filtered; the result is
+ * multiplied back afterwards. Neighbour weights combine distance, albedo and
+ * normal similarity and a relative irradiance difference that keeps shadow
+ * edges.
+ *
+ * Buffers are split into planes and processed in tiles on the pool; the
+ * innermost loop runs along a row for one filter tap at a time, so every
+ * plane is read contiguously. It only vectorizes where the compiler has a
+ * vector std::exp (glibc's libmvec with -ffast-math); otherwise the exp per
+ * tap keeps it scalar.
+ */
+struct DenoiseSettings {
+    int radius = 5;
+    float sigmaSpatial = 3.f;  // pixels
+    float sigmaAlbedo = 0.1f;
+    float sigmaNormal = 0.2f;  // on 1 - cos of the angle between normals
+    float sigmaColor = 0.5f;   // relative irradiance difference
+};
+
+// rgb, albedo and normal are width x height interleaved triples; returns denoised rgb
+std::vector<float> denoise(int width, int height, const std::vector<float> &rgb,
+                           const std::vector<float> &albedo, const std::vector<float> &normal,
+                           const DenoiseSettings &settings = {});
@@ -0,0 +1,71 @@
+#include "display.hpp"
+#include "util/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+template <ToneMap tm>
+inline float toneCurve(float v) {
+    if constexpr (tm == ToneMap::Reinhard) {
+        return v / (1.f + v);
+    } else if constexpr (tm == ToneMap::Aces) {
+        // Narkowicz's fit of the ACES filmic curve
+        return (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+    } else {
+        return v;
+    }
+}
+
+template <Transfer tf>
+inline float encode(float v) {
+    if constexpr (tf == Transfer::Gamma2) {
+        return std::sqrt(v);
+    } else if constexpr (tf == Transfer::SRGB) {
+        float lo = 12.92f * v;
+        float hi = 1.055f * std::pow(v, 1.f / 2.4f) - 0.055f;
+        return v <= 0.0031308f ? lo : hi;
+    } else {
+        return v;
+    }
+}
+
+template <ToneMap tm, Transfer tf>
+void applyImpl(float *values, std::size_t n, float scale) {
+    // the clamp curve keeps the [0, 0.999] range of the original 8-bit style output
+    const float hi = (tm == ToneMap::None) ? std::numeric_limits<float>::infinity()
+                   : (tm == ToneMap::Clamp) ? 0.999f : 1.f;
+    for (std::size_t i = 0; i < n; ++i) {
+        float v = std::max(values[i] * scale, 0.f);
+        values[i] = std::min(encode<tf>(toneCurve<tm>(v)), hi);
+    }
+}
+
+template <ToneMap tm>
+void applyTransfer(Transfer tf, float *values, std::size_t n, float scale) {
+    switch (tf) {
+    case Transfer::Linear: return applyImpl<tm, Transfer::Linear>(values, n, scale);
+    case Transfer::Gamma2: return applyImpl<tm, Transfer::Gamma2>(values, n, scale);
+    case Transfer::SRGB:   return applyImpl<tm, Transfer::SRGB>(values, n, scale);
+    }
+}
+
+} // namespace
+
+DisplayTransform::DisplayTransform(float exposure, ToneMap toneMap, Transfer transfer)
+: scale(std::exp2(exposure)), toneMap(toneMap), transfer(transfer) {}
+
+DisplayTransform DisplayTransform::fromOptions() {
+    return DisplayTransform(Options->exposure, Options->toneMap, Options->transfer);
+}
+
+void DisplayTransform::apply(float *rgb, std::size_t n) const {
+    PROFILE_SCOPE("DisplayTransform::apply");
+    switch (toneMap) {
+    case ToneMap::None:     return applyTransfer<ToneMap::None>(transfer, rgb, 3 * n, scale);
+    case ToneMap::Clamp:    return applyTransfer<ToneMap::Clamp>(transfer, rgb, 3 * n, scale);
+    case ToneMap::Reinhard: return applyTransfer<ToneMap::Reinhard>(transfer, rgb, 3 * n, scale);
+    case ToneMap::Aces:     return applyTransfer<ToneMap::Aces>(transfer, rgb, 3 * n, scale);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+#include "options.hpp"
+
+/*
+ * Maps linear radiance to display values: exposure, a tone curve and a
+ * transfer function. The film only ever holds linear, unclamped sums, so
+ * this runs at output time and can be re-run on the same film with other
+ * settings, e.g. for previews.
+ *
+ * Every step works per component, so apply() is one flat loop over the
+ * buffer that the compiler vectorizes; the settings are dispatched once per
+ * call, not per value.
+ */
+class DisplayTransform {
+public:
+    DisplayTransform(float exposure, ToneMap toneMap, Transfer transfer);
+
+    // from Options->exposure, toneMap and transfer
+    static DisplayTransform fromOptions();
+
+    // n linear RGB triples, in place
+    void apply(float *rgb, std::size_t n) const;
+
+private:
+    float scale;
+    ToneMap toneMap;
+    Transfer transfer;
+};
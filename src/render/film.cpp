@@ -0,0 +1,163 @@
+#include "film.hpp"
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+Film::Film(int width, int height, int blockSize)
+: w(width), h(height), blockSz(blockSize),
+  blocksX((width + blockSize - 1) / blockSize),
+  blocksY((height + blockSize - 1) / blockSize),
+  blocks(std::make_unique<Block[]>(std::size_t(blocksX) * blocksY)) {
+    CHECK_GT(blockSize, 0);
+}
+
+void Film::merge(const FilmTile &tile) {
+    PROFILE_SCOPE_COUNTERS("Film::merge");
+    const Bounds2<int> &tb = tile.bounds();
+    int bx0 = std::max(tb.pMin.x, 0) / blockSz, bx1 = (std::min(tb.pMax.x, w) - 1) / blockSz;
+    int by0 = std::max(tb.pMin.y, 0) / blockSz, by1 = (std::min(tb.pMax.y, h) - 1) / blockSz;
+
+    for (int by = by0; by <= by1; ++by) {
+        for (int bx = bx0; bx <= bx1; ++bx) {
+            Block &block = blocks[std::size_t(by) * blocksX + bx];
+            int x0 = std::max(tb.pMin.x, bx * blockSz), x1 = std::min({tb.pMax.x, (bx + 1) * blockSz, w});
+            int y0 = std::max(tb.pMin.y, by * blockSz), y1 = std::min({tb.pMax.y, (by + 1) * blockSz, h});
+
+            std::lock_guard<std::mutex> lock(block.mutex);
+            if (block.pixels.empty()) {
+                block.pixels.allocate(std::size_t(blockSz) * blockSz);
+                block.pixels.zero();
+            }
+
+            for (int y = y0; y < y1; ++y) {
+                Pixel *row = &block.pixels[std::size_t(y - by * blockSz) * blockSz];
+                for (int x = x0; x < x1; ++x) {
+                    const FilmTile::Pixel &src = tile.pixel(Point2<int>(x, y));
+                    Pixel &dst = row[x - bx * blockSz];
+                    dst.rgbSum[0] += src.rgb[0];
+                    dst.rgbSum[1] += src.rgb[1];
+                    dst.rgbSum[2] += src.rgb[2];
+                    dst.weightSum += src.weight;
+                    dst.lumSum += src.lumSum;
+                    dst.lumSqSum += src.lumSqSum;
+                    dst.nSamples += src.nSamples;
+                }
+            }
+        }
+    }
+}
+
+const Film::Pixel *Film::pixel(int x, int y) const {
+    DCHECK(x >= 0 && x < w && y >= 0 && y < h);
+    const Block &block = blocks[std::size_t(y / blockSz) * blocksX + x / blockSz];
+    if (block.pixels.empty())
+        return nullptr;
+    return &block.pixels[std::size_t(y % blockSz) * blockSz + x % blockSz];
+}
+
+color Film::average(int x, int y) const {
+    const Pixel *p = pixel(x, y);
+    if (!p || p->weightSum == 0)
+        return color(0, 0, 0);
+    return color(p->rgbSum[0], p->rgbSum[1], p->rgbSum[2]) / p->weightSum;
+}
+
+Float Film::weight(int x, int y) const {
+    const Pixel *p = pixel(x, y);
+    return p ? p->weightSum : 0;
+}
+
+void Film::resolveRow(int y, int x0, int x1, float *rgb, float *alpha) const {
+    for (int x = x0; x < x1; ++x, rgb += 3) {
+        const Pixel *p = pixel(x, y);
+        bool covered = p && p->weightSum != 0;
+        double invWeight = covered ? 1 / p->weightSum : 0;
+
+        rgb[0] = covered ? float(p->rgbSum[0] * invWeight) : 0.f;
+        rgb[1] = covered ? float(p->rgbSum[1] * invWeight) : 0.f;
+        rgb[2] = covered ? float(p->rgbSum[2] * invWeight) : 0.f;
+        if (alpha)
+            *alpha++ = covered ? 1.f : 0.f;
+    }
+}
+
+Float Film::samples(int x, int y) const {
+    const Pixel *p = pixel(x, y);
+    return p ? p->nSamples : 0;
+}
+
+Bounds2<int> Film::blockBounds(int index) const {
+    int x0 = (index % blocksX) * blockSz, y0 = (index / blocksX) * blockSz;
+    return {Point2<int>(x0, y0), Point2<int>(std::min(x0 + blockSz, w), std::min(y0 + blockSz, h))};
+}
+
+void Film::releaseBlock(int index) {
+    Block &block = blocks[index];
+    std::lock_guard<std::mutex> lock(block.mutex);
+    block.pixels.release();
+}
+
+std::vector<Film::Pixel> Film::snapshot() const {
+    PROFILE_SCOPE("Film::snapshot");
+    std::vector<Pixel> pixels(std::size_t(w) * h, Pixel{});
+
+    parallelFor(0, numBlocks(), [&](int64_t i) {
+        const Block &block = blocks[i];
+        std::lock_guard<std::mutex> lock(block.mutex);
+        if (block.pixels.empty())
+            return;
+
+        Bounds2<int> b = blockBounds(i);
+        for (int y = b.pMin.y; y < b.pMax.y; ++y)
+            std::copy_n(&block.pixels[std::size_t(y - b.pMin.y) * blockSz], b.pMax.x - b.pMin.x,
+                        &pixels[std::size_t(y) * w + b.pMin.x]);
+    });
+    return pixels;
+}
+
+void Film::restore(const std::vector<Pixel> &pixels) {
+    CHECK_EQ(pixels.size(), std::size_t(w) * h);
+
+    parallelFor(0, numBlocks(), [&](int64_t i) {
+        Block &block = blocks[i];
+        std::lock_guard<std::mutex> lock(block.mutex);
+        block.pixels.allocate(std::size_t(blockSz) * blockSz);
+        block.pixels.zero();
+
+        Bounds2<int> b = blockBounds(i);
+        for (int y = b.pMin.y; y < b.pMax.y; ++y)
+            std::copy_n(&pixels[std::size_t(y) * w + b.pMin.x], b.pMax.x - b.pMin.x,
+                        &block.pixels[std::size_t(y - b.pMin.y) * blockSz]);
+    });
+}
+
+Float Film::estimateNoise() const {
+    PROFILE_SCOPE_COUNTERS("Film::estimateNoise");
+    std::vector<double> rowError(h, 0.0);
+    std::vector<int64_t> rowCount(h, 0);
+
+    parallelFor(0, h, [&](int64_t y) {
+        for (int x = 0; x < w; ++x) {
+            const Pixel *p = pixel(x, y);
+            if (!p || p->nSamples < 2)
+                continue;
+
+            double n = p->nSamples;
+            double mean = p->lumSum / n;
+            double variance = std::max(0.0, (p->lumSqSum - n * mean * mean) / (n - 1));
+            // the floor keeps near-black pixels from dominating the average
+            rowError[y] += std::sqrt(variance / n) / std::max(mean, 1e-2);
+            ++rowCount[y];
+        }
+    }, 8);
+
+    double error = 0;
+    int64_t count = 0;
+    for (int y = 0; y < h; ++y) {
+        error += rowError[y];
+        count += rowCount[y];
+    }
+    return count > 0 ? error / count : infinity;
+}
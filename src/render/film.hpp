@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "color.h"
+#include "filter.hpp"
+#include "raytracer.hpp"
+#include "util/memory.hpp"
+#include "util/vecmath.hpp"
+
+/*
+ * Private accumulation buffer for the tile a thread is rendering. Nothing
+ * in here is shared, so samples are added without locks or atomics; the
+ * tile is merged into the Film in one go when it is finished.
+ *
+ * With a filter wider than a pixel, samples near the tile edge also land
+ * in neighbouring tiles' pixels, so the buffer covers the tile plus an
+ * apron of filter.apron() pixels; see paddedBounds().
+ */
+class FilmTile {
+public:
+    struct Pixel {
+        float rgb[3];
+        float weight;
+        // unweighted luminance moments, for the noise estimate
+        float lumSum, lumSqSum;
+        float nSamples;
+    };
+
+    // reuses the allocation, so one FilmTile per thread serves every tile it renders
+    void reset(const Bounds2<int> &bounds) {
+        b = bounds;
+        stride = bounds.pMax.x - bounds.pMin.x;
+        pixels.allocate(std::size_t(stride) * (bounds.pMax.y - bounds.pMin.y));
+        pixels.zero();
+    }
+
+    void addSample(Point2<int> p, const color &L, Float weight = 1) {
+        Pixel &px = pixels[index(p)];
+        px.rgb[0] += float(weight * L.x);
+        px.rgb[1] += float(weight * L.y);
+        px.rgb[2] += float(weight * L.z);
+        px.weight += float(weight);
+        addMoments(px, L);
+    }
+
+    // adds a sample at continuous film position p, where pixel (x, y) covers
+    // [x, x+1) x [y, y+1), to every pixel of the tile the filter reaches;
+    // the noise moments only go to the pixel p falls in
+    void splat(Point2f p, const color &L, const Filter &filter) {
+        float r = filter.radius();
+        int x0 = std::max(int(std::floor(p.x - 0.5f - r)) + 1, b.pMin.x);
+        int x1 = std::min(int(std::floor(p.x - 0.5f + r)), b.pMax.x - 1);
+        int y0 = std::max(int(std::floor(p.y - 0.5f - r)) + 1, b.pMin.y);
+        int y1 = std::min(int(std::floor(p.y - 0.5f + r)), b.pMax.y - 1);
+
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float w = filter.weight(float(x + 0.5f - p.x), float(y + 0.5f - p.y));
+                Pixel &px = pixels[index(Point2<int>(x, y))];
+                px.rgb[0] += float(w * L.x);
+                px.rgb[1] += float(w * L.y);
+                px.rgb[2] += float(w * L.z);
+                px.weight += w;
+            }
+        }
+
+        addMoments(pixels[index(Point2<int>(int(p.x), int(p.y)))], L);
+    }
+
+    // the pixels a tile's samples can reach, clipped to the image
+    static Bounds2<int> paddedBounds(const Bounds2<int> &tile, const Filter &filter, const Bounds2<int> &image) {
+        int a = filter.apron();
+        return intersect(Bounds2<int>(tile.pMin - Vector2<int>(a, a), tile.pMax + Vector2<int>(a, a)), image);
+    }
+
+    const Pixel &pixel(Point2<int> p) const { return pixels[index(p)]; }
+    const Bounds2<int> &bounds() const { return b; }
+
+private:
+    static void addMoments(Pixel &px, const color &L) {
+        float lum = float(luminance(L));
+        px.lumSum += lum;
+        px.lumSqSum += lum * lum;
+        px.nSamples += 1;
+    }
+
+    std::size_t index(Point2<int> p) const {
+        DCHECK(p.x >= b.pMin.x && p.x < b.pMax.x && p.y >= b.pMin.y && p.y < b.pMax.y);
+        return std::size_t(p.y - b.pMin.y) * stride + (p.x - b.pMin.x);
+    }
+
+    Bounds2<int> b;
+    int stride = 0;
+    AlignedArray<Pixel> pixels;
+};
+
+/*
+ * Weighted sums of every sample merged so far. Calling merge() again for
+ * the same pixels (another pass) keeps accumulating, so the image can be
+ * resolved after any number of passes.
+ *
+ * Storage is split into blockSize x blockSize blocks, each with its own
+ * lock and allocated on first merge. Tiles on the same block grid never
+ * contend, and no cache line is shared between two blocks.
+ */
+class Film {
+public:
+    struct Pixel {
+        double rgbSum[3];
+        double weightSum;
+        double lumSum, lumSqSum;
+        double nSamples;
+    };
+
+    Film(int width, int height, int blockSize);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    Bounds2<int> bounds() const { return {Point2<int>(0, 0), Point2<int>(w, h)}; }
+
+    void merge(const FilmTile &tile);
+
+    // weighted average radiance, black where nothing has been merged yet
+    color average(int x, int y) const;
+    Float weight(int x, int y) const;
+    Float samples(int x, int y) const;
+
+    // linear averages of pixels [x0, x1) of row y as float RGB triples, plus
+    // 1 or 0 coverage per pixel in alpha if it is given
+    void resolveRow(int y, int x0, int x1, float *rgb, float *alpha = nullptr) const;
+
+    // the storage blocks, numbered row-major; a released block reads as black again
+    int numBlocks() const { return blocksX * blocksY; }
+    int blockSize() const { return blockSz; }
+    Bounds2<int> blockBounds(int index) const;
+    void releaseBlock(int index);
+
+    // row-major copy of every pixel, for checkpoints; restore() replaces the contents
+    std::vector<Pixel> snapshot() const;
+    void restore(const std::vector<Pixel> &pixels);
+
+    // mean relative standard error of the pixel estimates, over pixels with 2+ samples
+    Float estimateNoise() const;
+
+private:
+    struct Block {
+        mutable std::mutex mutex;
+        AlignedArray<Pixel> pixels;
+    };
+
+    const Pixel *pixel(int x, int y) const;
+
+    int w, h, blockSz, blocksX, blocksY;
+    std::unique_ptr<Block[]> blocks;
+};
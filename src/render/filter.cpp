@@ -0,0 +1,55 @@
+#include "filter.hpp"
+#include "util/math.hpp"
+#include <algorithm>
+#include <cmath>
+
+static float defaultRadius(FilterType type) {
+    switch (type) {
+    case FilterType::Box:            return 0.5f;
+    case FilterType::Gaussian:       return 1.5f;
+    case FilterType::Mitchell:       return 2.f;
+    case FilterType::BlackmanHarris: return 2.f;
+    }
+    return 0.5f;
+}
+
+// the 1D profile at distance x in [0, radius]
+static float evaluate(FilterType type, float x, float radius) {
+    switch (type) {
+    case FilterType::Box:
+        return 1.f;
+    case FilterType::Gaussian: {
+        constexpr float alpha = 2.f;
+        return std::max(0.f, std::exp(-alpha * x * x) - std::exp(-alpha * radius * radius));
+    }
+    case FilterType::Mitchell: {
+        // B = C = 1/3, stretched so the support [-2, 2] covers the radius
+        constexpr float B = 1.f / 3.f, C = 1.f / 3.f;
+        float t = 2.f * x / radius;
+        if (t > 1.f)
+            return ((-B - 6 * C) * t * t * t + (6 * B + 30 * C) * t * t +
+                    (-12 * B - 48 * C) * t + (8 * B + 24 * C)) / 6.f;
+        return ((12 - 9 * B - 6 * C) * t * t * t + (-18 + 12 * B + 6 * C) * t * t +
+                (6 - 2 * B)) / 6.f;
+    }
+    case FilterType::BlackmanHarris: {
+        float t = 0.5f + 0.5f * x / radius;
+        return 0.35875f - 0.48829f * std::cos(2 * Pi * t) + 0.14128f * std::cos(4 * Pi * t) -
+               0.01168f * std::cos(6 * Pi * t);
+    }
+    }
+    return 0.f;
+}
+
+Filter::Filter(FilterType type, float radius)
+: filterType(type), r(radius > 0 ? radius : defaultRadius(type)), invRadius(1 / r),
+  // a sample at x reaches pixels whose centers are within r, i.e. up to
+  // ceil(r - 1/2) pixels past the one it falls in
+  apronPixels(std::max(0, int(std::ceil(r - 0.5f)))) {
+    for (int i = 0; i < tableSize; ++i)
+        table[i] = evaluate(type, (i + 0.5f) * r / tableSize, r);
+}
+
+Filter Filter::fromOptions() {
+    return Filter(Options->filter, Options->filterRadius);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+
+#include "options.hpp"
+#include "raytracer.hpp"
+
+/*
+ * Pixel reconstruction filter. All supported filters are separable, so the
+ * weight of a sample for a pixel is the product of two lookups into a small
+ * table of the 1D profile, precomputed over [0, radius].
+ */
+class Filter {
+public:
+    static constexpr int tableSize = 32;
+
+    // radius <= 0 picks the filter's usual radius
+    Filter(FilterType type, float radius = 0.f);
+
+    static Filter fromOptions();
+
+    FilterType type() const { return filterType; }
+    float radius() const { return r; }
+
+    // pixels beyond a tile edge that samples inside the tile can reach
+    int apron() const { return apronPixels; }
+
+    float weight(float dx, float dy) const { return lookup(dx) * lookup(dy); }
+
+private:
+    float lookup(float d) const {
+        int i = int(std::abs(d) * invRadius * tableSize);
+        return i < tableSize ? table[i] : 0.f;
+    }
+
+    FilterType filterType;
+    float r, invRadius;
+    int apronPixels;
+    std::array<float, tableSize> table;
+};
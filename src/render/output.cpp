@@ -0,0 +1,102 @@
+#include "output.hpp"
+#include "util/error.hpp"
+#include "util/log.hpp"
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+using namespace OIIO;
+
+static const char *compressionName(Compression c) {
+    switch (c) {
+    case Compression::None: return "none";
+    case Compression::Zip:  return "zip";
+    case Compression::Piz:  return "piz";
+    case Compression::Dwaa: return "dwaa";
+    }
+    return "zip";
+}
+
+OutputFormat::OutputFormat()
+: file(Options->outFile), halfFloat(Options->halfFloat),
+  pixelType(Options->halfFloat ? TypeDesc::HALF : TypeDesc::FLOAT),
+  display(DisplayTransform::fromOptions()) {
+    static const std::string names = "RGBA";
+
+    if (file.empty())
+        errorFatal("No output file name given");
+
+    for (char c : Options->outChannels) {
+        auto i = names.find(c);
+        if (i == std::string::npos)
+            errorFatal("Unknown output channel '{}' in \"{}\", expected R, G, B or A", c, Options->outChannels);
+        if (std::find(channelMap.begin(), channelMap.end(), int(i)) != channelMap.end())
+            errorFatal("Output channel '{}' given twice in \"{}\"", c, Options->outChannels);
+        channelMap.push_back(int(i));
+    }
+    if (channelMap.empty())
+        errorFatal("No output channels selected");
+}
+
+ImageSpec OutputFormat::spec(int width, int height, int tileSize) const {
+    ImageSpec spec(width, height, channels(), pixelType);
+
+    spec.channelnames.clear();
+    for (int c : channelMap)
+        spec.channelnames.push_back(std::string(1, "RGBA"[c]));
+    if (auto a = std::find(channelMap.begin(), channelMap.end(), 3); a != channelMap.end())
+        spec.alpha_channel = int(a - channelMap.begin());
+
+    spec.attribute("compression", compressionName(Options->compression));
+    if (tileSize > 0)
+        spec.tile_width = spec.tile_height = tileSize;
+    return spec;
+}
+
+void OutputFormat::resolve(const Film &film, const Bounds2<int> &region, float *out, int stride,
+                           const float *linear) const {
+    int n = region.pMax.x - region.pMin.x;
+    static thread_local std::vector<float> rgb, alpha;
+    rgb.resize(3 * n);
+    alpha.resize(n);
+
+    for (int y = region.pMin.y; y < region.pMax.y; ++y) {
+        film.resolveRow(y, region.pMin.x, region.pMax.x, rgb.data(), alpha.data());
+        if (linear)
+            std::copy_n(linear + (std::size_t(y) * film.width() + region.pMin.x) * 3, 3 * n, rgb.data());
+        display.apply(rgb.data(), n);
+
+        float *row = out + std::size_t(y - region.pMin.y) * stride * channels();
+        for (int x = 0; x < n; ++x)
+            for (int c = 0; c < channels(); ++c)
+                row[x * channels() + c] = channelMap[c] == 3 ? alpha[x] : rgb[3 * x + channelMap[c]];
+    }
+}
+
+TypeDesc OutputFormat::encode(std::span<const float> pixels, std::vector<uint16_t> &halfPixels) const {
+    if (!halfFloat)
+        return TypeDesc::FLOAT;
+
+    PROFILE_SCOPE_COUNTERS("OutputFormat::encode");
+    halfPixels.resize(pixels.size());
+
+    // OIIO would convert serially inside write_image
+    constexpr int64_t chunk = 1 << 16;
+    parallelFor(0, (pixels.size() + chunk - 1) / chunk, [&](int64_t i) {
+        std::size_t begin = i * chunk, n = std::min<std::size_t>(chunk, pixels.size() - begin);
+        convert_pixel_values(TypeDesc::FLOAT, &pixels[begin], TypeDesc::HALF, &halfPixels[begin], int(n));
+    });
+    return TypeDesc::HALF;
+}
+
+void reportOutput(const std::string &filename, int64_t encodeNs) {
+    std::error_code ec;
+    auto bytes = std::filesystem::file_size(filename, ec);
+    if (ec) {
+        warning("{}: unable to read back file size: {}", filename, ec.message());
+        return;
+    }
+    LOG_VERBOSE("Wrote {} ({:.2f} MiB) in {:.1f}ms", filename, bytes / double(1 << 20), encodeNs / 1e6);
+}
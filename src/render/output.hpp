@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/imageio.h>
+
+#include "display.hpp"
+#include "film.hpp"
+
+/*
+ * What the output image looks like on disk, from Options: file name, the
+ * channels to write (R, G, B and A, where A is pixel coverage), float or
+ * half precision and the EXR compression codec, plus the display transform
+ * applied on the way out. Both the buffered and the streaming writer go
+ * through this, so they produce the same file.
+ */
+class OutputFormat {
+public:
+    OutputFormat();
+
+    const std::string &filename() const { return file; }
+    int channels() const { return int(channelMap.size()); }
+    bool half() const { return halfFloat; }
+
+    // tileSize > 0 makes a tiled image
+    OIIO::ImageSpec spec(int width, int height, int tileSize = 0) const;
+
+    // display-ready values of the pixels in region, channels() floats per pixel
+    // in file order; rows start stride pixels apart in out. A full-frame
+    // linear RGB buffer (e.g. denoised) replaces the film's radiance if given.
+    void resolve(const Film &film, const Bounds2<int> &region, float *out, int stride,
+                 const float *linear = nullptr) const;
+
+    // data and type to hand to write_image/write_tile; converts to half on the pool
+    // if needed, serially when called from a thread outside the pool (the tile writer)
+    OIIO::TypeDesc encode(std::span<const float> pixels, std::vector<uint16_t> &halfPixels) const;
+
+private:
+    std::string file;
+    std::vector<int> channelMap;  // 0-2 for R, G, B, 3 for A
+    bool halfFloat;
+    OIIO::TypeDesc pixelType;
+    DisplayTransform display;
+};
+
+// logs the size on disk and the time spent encoding and writing a finished image
+void reportOutput(const std::string &filename, int64_t encodeNs);
@@ -1,90 +1,377 @@
 #include "render.hpp"
+#include "aov.hpp"
+#include "checkpoint.hpp"
+#include "costmap.hpp"
+#include "denoise.hpp"
+#include "film.hpp"
+#include "output.hpp"
+#include "tiles.hpp"
+#include "tilewriter.hpp"
 #include "util/log.hpp"
+#include "util/parallel.hpp"
+#include "util/random.hpp"
+#include "util/stats.hpp"
+#include "util/trace.hpp"
 #include <OpenImageIO/imageio.h>
+#include <csignal>
 #include <cstddef>
+#include <cstdio>
+#include <print>
 #include <syncstream>
 
 using namespace OIIO;
 
-std::vector<Bounds2<int>> makeTiles(int W, int H, int TILE) {
-    std::vector<Bounds2<int>> tiles;
-    int tilesX = (W + TILE - 1) / TILE;
-    int tilesY = (H + TILE - 1) / TILE;
+static std::atomic<bool> cancelRequested{false};
 
-    tiles.reserve(tilesX * tilesY);
-
-    for (int ty = 0; ty < tilesY; ++ty) {
-        for (int tx = 0; tx < tilesX; ++tx) {
-            int x0 = tx * TILE;
-            int y0 = ty * TILE;
-            int x1 = std::min(x0 + TILE, W);
-            int y1 = std::min(y0 + TILE, H);
-            tiles.push_back({Point2<int>(x0, y0), Point2<int>(x1, y1)});
-        }
+// first SIGINT/SIGTERM asks for a clean stop, a second one kills the process as usual
+static void onCancelSignal(int sig) {
+    if (cancelRequested.exchange(true)) {
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
     }
-    return tiles;
 }
 
-void renderThread(const Scene &scene, const Bounds2<int> &t, int W, int H, int C, std::vector<float> &film) {
+// installs the cancel handler for the lifetime of a render, then puts the old ones back
+class CancelScope {
+public:
+    CancelScope() {
+        cancelRequested = false;
+        struct sigaction sa = {};
+        sa.sa_handler = onCancelSignal;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGINT, &sa, &oldInt);
+        sigaction(SIGTERM, &sa, &oldTerm);
+    }
+    ~CancelScope() {
+        sigaction(SIGINT, &oldInt, nullptr);
+        sigaction(SIGTERM, &oldTerm, nullptr);
+    }
+
+private:
+    struct sigaction oldInt, oldTerm;
+};
+
+// adds samples [firstSample, firstSample + nSamples) to every pixel of t
+void renderThread(const Scene &scene, const Bounds2<int> &t, Film &film, const Filter &filter,
+                  AovFilm *aovs, CostMap *cost, int firstSample, int nSamples) {
+    PROFILE_SCOPE_COUNTERS("renderThread");
+    TraceScope trace("tile");
+    trace.arg("x", t.pMin.x).arg("y", t.pMin.y).arg("w", t.pMax.x - t.pMin.x).arg("h", t.pMax.y - t.pMin.y);
+
+    static thread_local FilmTile tile;
+    tile.reset(FilmTile::paddedBounds(t, filter, film.bounds()));
+
     auto cam = scene.camera;
+    const Spheres &world = scene.localWorld();
+
+    AovSample aovSample;
+    AovSample *aov = (aovs && aovs->needsHits()) ? &aovSample : nullptr;
+    bool timeAov = aovs && aovs->wants(AovFilm::Time);
+    bool timePixels = timeAov || cost;
 
     for (int y = t[0].y; y < t[1].y; ++y) {
         for (int x = t[0].x; x < t[1].x; ++x) {
-            color pixel_color(0, 0, 0);
-            for (int sample = 0; sample < cam.samples_per_pixel; ++sample) {
-                Ray r = cam.get_ray(x, y);
-                pixel_color += cam.ray_color(r, scene.world);
+            uint64_t pixelIndex = uint64_t(y) * cam.image_width + x;
+            auto pixelStart = timePixels ? curr_time() : timePoint();
+
+            for (int sample = firstSample; sample < firstSample + nSamples; ++sample) {
+                // seeded per pixel and sample, so neither the thread that runs a tile nor
+                // the way samples are split into passes (or resumed runs) changes the image
+                Rand::seed(Rand::mixBits(Rand::mixBits(pixelIndex ^ (uint64_t(sample) << 40)) ^ Options->seed));
+                Point2f pFilm(x + Rand::random<Float>(), y + Rand::random<Float>());
+                Ray r = cam.get_ray(pFilm);
+                if (aov)
+                    aovSample = AovSample();
+                tile.splat(pFilm, cam.ray_color(r, world, scene.envLight.get(), aov), filter);
+                if (aov)
+                    aovs->addSample(x, y, aovSample);
+            }
+
+            if (timePixels) {
+                int64_t ns = diff_time<nanoseconds>(pixelStart, curr_time()).count();
+                if (timeAov)
+                    aovs->addTime(x, y, ns);
+                if (cost)
+                    cost->addPixel(x, y, ns);
             }
-            write_color(film, cam.pixel_samples_scale*pixel_color, (y*W+x) * C);
         }
     }
+
+    film.merge(tile);
 }
 
-void render(const Scene &scene) {
+RenderStats render(const Scene &scene) {
     PROFILE_SCOPE("render");
 
     auto cam = scene.camera;
 
-    const char* filename = "image.exr";
-    const int xres = cam.image_width, yres = cam.image_height, channels = 3;
+    const OutputFormat format;
+    const int xres = cam.image_width, yres = cam.image_height, channels = format.channels();
+    const bool progressive = Options->renderMode == RenderMode::Progressive;
 
     LOG_VERBOSE("image_height      = {}", yres);
     LOG_VERBOSE("image_width       = {}", xres);
     LOG_VERBOSE("samples_per_pixel = {}", cam.samples_per_pixel);
 
-    std::vector<float> pixels(xres * yres * channels);
+    int nThreads = threadPool->size();
+    int tileSize = Options->tileSize;
+    if (Options->adaptiveTiles)
+        tileSize = adaptiveTileSize(xres, yres, tileSize, nThreads);
+
+    Film film(xres, yres, tileSize);
+    const Filter filter = Filter::fromOptions();
+    auto tiles = makeTiles(xres, yres, tileSize, Options->tileOrder,
+                           Options->adaptiveTiles ? 2 * nThreads : 0);
 
-    auto tiles = makeTiles(xres, yres, 32);
-    std::atomic<std::size_t> nextTile{0},tilesLeft{tiles.size()};
-    std::vector<std::thread> threads;
-    threads.reserve(Options->nThreads);
+    LOG_VERBOSE("tiles             = {} ({}px)", tiles.size(), tileSize);
+    LOG_VERBOSE("filter radius     = {} ({}px apron)", filter.radius(), filter.apron());
 
+    // time each thread spends inside renderThread, padded against false sharing
+    struct alignas(64) ThreadTime { int64_t busyNs = 0; };
+    std::vector<ThreadTime> busy(nThreads);
+
+    int samplesDone = 0, pass = 0;
+    if (!Options->resumeFile.empty()) {
+        samplesDone = std::min(loadCheckpoint(Options->resumeFile, film), cam.samples_per_pixel);
+        LOG_VERBOSE("Resuming from {} at {} spp", Options->resumeFile, samplesDone);
+    }
+
+    // checkpoints need pass boundaries, so they split final renders into passes too
+    std::unique_ptr<Checkpointer> checkpointer;
+    if (!Options->checkpointFile.empty())
+        checkpointer = std::make_unique<Checkpointer>(Options->checkpointFile);
+    bool multiPass = progressive || checkpointer;
+    int passSpp = multiPass ? std::max(Options->passSpp, 1) : cam.samples_per_pixel;
+
+    std::unique_ptr<AovFilm> aovs;
+    unsigned aovOutputs = AovFilm::parse(Options->aovs);
+    unsigned aovMask = aovOutputs | (Options->denoise ? AovFilm::Albedo | AovFilm::Normal : 0);
+    if (aovMask)
+        aovs = std::make_unique<AovFilm>(xres, yres, aovMask, aovOutputs);
+
+    std::unique_ptr<CostMap> cost;
+    if (!Options->heatmapFile.empty())
+        cost = std::make_unique<CostMap>(xres, yres, tiles);
+
+    std::unique_ptr<TileWriter> writer;
+    if (Options->streamOutput && Options->writeOutput) {
+        if (multiPass)
+            warning("Streaming output needs a single pass, writing {} at the end instead", format.filename());
+        else if (aovs)
+            warning("Streaming output does not support AOVs or denoising, writing {} at the end instead",
+                    format.filename());
+        else
+            writer = std::make_unique<TileWriter>(format, film, filter, tiles);
+    }
+
+    CancelScope cancelScope;
+
+    RayStats::resetAll();
     auto t1 = curr_time();
+    auto lastCheckpoint = t1;
+    int64_t budgetNs = progressive ? int64_t(Options->timeBudget * 1e9) : 0;
+    bool stop = false;
 
-    for (int t = 0; t < Options->nThreads; ++t) {
-        threads.emplace_back([&](){
-            while (true) {
-                int i = nextTile.fetch_add(1);
-                if (i >= tiles.size()) break;
-                renderThread(scene, tiles[i], xres, yres, channels, pixels);
+    while (!stop && samplesDone < cam.samples_per_pixel) {
+        int nSamples = std::min(passSpp, cam.samples_per_pixel - samplesDone);
+        std::atomic<std::size_t> tilesLeft{tiles.size()};
+        auto passStart = curr_time();
+        TraceScope passTrace("pass");
+        passTrace.arg("pass", pass).arg("firstSample", samplesDone).arg("spp", nSamples);
 
-                int left = tilesLeft.fetch_sub(1, std::memory_order_relaxed) - 1;
-                if ((left % 20) == 0) std::clog << "\rTiles left: " << left << "   " << std::flush;
-            }
+        // in makeTiles() order, so neighbouring tiles render together and the
+        // small tail tiles come last
+        parallelForOrdered(0, tiles.size(), [&](int64_t i) {
+            // the first pass always covers the whole image, later ones may be cut short
+            if (cancelRequested.load(std::memory_order_relaxed) ||
+                (pass > 0 && budgetNs > 0 && diff_time<nanoseconds>(t1, curr_time()).count() > budgetNs))
+                return;
+
+            auto start = curr_time();
+            uint64_t raysBefore = cost ? RayStats::local().totalRays() : 0;
+            renderThread(scene, tiles[i], film, filter, aovs.get(), cost.get(), samplesDone, nSamples);
+            int64_t tileNs = diff_time<nanoseconds>(start, curr_time()).count();
+            busy[ThreadPool::threadIndex()].busyNs += tileNs;
+            if (cost)
+                cost->addTile(i, tileNs, RayStats::local().totalRays() - raysBefore);
+            if (writer)
+                writer->tileDone(tiles[i]);
+
+            int left = tilesLeft.fetch_sub(1, std::memory_order_relaxed) - 1;
+            if (!progressive && (left % 20) == 0) std::clog << "\rTiles left: " << left << "   " << std::flush;
         });
-    }
 
-    for (auto& th : threads) th.join();
+        // a pass cut short leaves uneven sample counts, only whole passes are
+        // counted so the reported spp is what every pixel has
+        ++pass;
+        std::size_t tilesRendered = tiles.size() - tilesLeft;
+        if (tilesRendered == tiles.size()) {
+            samplesDone += nSamples;
+        } else {
+            LOG_VERBOSE("pass {:>3}: cut short after {} of {} tiles", pass, tilesRendered, tiles.size());
+            stop = true;
+        }
+
+        if (cancelRequested) {
+            warning("Render cancelled after {} spp, writing what has been accumulated", samplesDone);
+            break;
+        }
+
+        auto now = curr_time();
+        if (progressive) {
+            Float noise = 0;
+            if (Options->targetNoise > 0) {
+                TraceScope trace("estimate noise");
+                noise = film.estimateNoise();
+            }
+            LOG_VERBOSE("pass {:>3}: {:>5} spp in {}ms{}", pass, samplesDone,
+                        diff_time<milliseconds>(passStart, now).count(),
+                        Options->targetNoise > 0 ? std::format(", noise {:.4f}", noise) : std::string());
+
+            if (Options->targetNoise > 0 && noise <= Options->targetNoise) {
+                LOG_VERBOSE("Reached target noise {} after {} spp", Options->targetNoise, samplesDone);
+                stop = true;
+            }
+
+            // stop early if the next pass, judged by the last one, would overrun the budget
+            if (budgetNs > 0) {
+                int64_t elapsedNs = diff_time<nanoseconds>(t1, now).count();
+                int64_t lastPassNs = diff_time<nanoseconds>(passStart, now).count();
+                if (elapsedNs + lastPassNs > budgetNs) {
+                    LOG_VERBOSE("Time budget of {}s reached after {} spp", Options->timeBudget, samplesDone);
+                    stop = true;
+                }
+            }
+        }
+
+        // a render stopped early can be picked up again from its last checkpoint;
+        // passes cut short by the deadline leave uneven sample counts and are not saved
+        if (checkpointer && tilesLeft == 0 && samplesDone < cam.samples_per_pixel &&
+            (stop || diff_time<milliseconds>(lastCheckpoint, now).count() >= Options->checkpointInterval * 1e3)) {
+            checkpointer->save(film, samplesDone);
+            lastCheckpoint = now;
+        }
+    }
+    if (checkpointer)
+        checkpointer->wait();
 
     auto t2 = curr_time();
     auto ms_int = diff_time<milliseconds>(t1, t2);
-    LOG_VERBOSE("Finished ray tracing in {}ms", ms_int.count());
+    LOG_VERBOSE("Finished ray tracing in {}ms ({} passes)", ms_int.count(), pass);
+
+    int64_t wallNs = diff_time<nanoseconds>(t1, t2).count();
+    for (int t = 0; t < nThreads; ++t) {
+        int64_t idleNs = std::max<int64_t>(wallNs - busy[t].busyNs, 0);
+        LOG_VERBOSE("thread {:>3}: busy {:>8.1f}ms  idle {:>8.1f}ms ({:.1f}%)", t,
+                    busy[t].busyNs / 1e6, idleNs / 1e6,
+                    wallNs > 0 ? 100.0 * idleNs / wallNs : 0.0);
+    }
+    RenderStats stats;
+    stats.wallNs = wallNs;
+    stats.samplesPerPixel = samplesDone;
+    stats.passes = pass;
+    stats.rays = RayStats::mergeAll();
+    for (const ThreadTime &t : busy)
+        stats.busyNs.push_back(t.busyNs);
+    reportRayStats(stats.rays, wallNs / 1e9);
+    if (!Options->writeOutput)
+        return stats;
+    if (cost) {
+        TraceScope trace("write heatmap", "io");
+        cost->write(Options->heatmapFile);
+    }
+
+    if (writer) {
+        auto tailStart = curr_time();
+        writer->finish();
+        LOG_VERBOSE("Streamed {}, {}ms after the last tile", format.filename(),
+                    diff_time<milliseconds>(tailStart, curr_time()).count());
+        reportOutput(format.filename(), writer->writeNs());
+        return stats;
+    }
+
+    std::vector<float> denoised;
+    if (Options->denoise) {
+        TraceScope trace("denoise", "post");
+        auto denoiseStart = curr_time();
+        std::vector<float> radiance(std::size_t(xres) * yres * 3);
+        parallelFor(0, yres, [&](int64_t y) {
+            film.resolveRow(y, 0, xres, &radiance[std::size_t(y) * xres * 3]);
+        }, 16);
 
-    std::unique_ptr<ImageOutput> out = ImageOutput::create("image.exr");
-    DCHECK(out);
+        denoised = denoise(xres, yres, radiance, aovs->resolve(AovFilm::Albedo, film),
+                           aovs->resolve(AovFilm::Normal, film));
 
-    ImageSpec spec(xres, yres, channels, TypeDesc::FLOAT);
-    out->open(filename, spec);
-    out->write_image(make_cspan(pixels));
-    out->close();
+        int64_t denoiseNs = diff_time<nanoseconds>(denoiseStart, curr_time()).count();
+        LOG_VERBOSE("Denoised in {:.1f}ms ({:.1f}% of ray tracing)", denoiseNs / 1e6,
+                    wallNs > 0 ? 100.0 * denoiseNs / wallNs : 0.0);
+    }
+
+    auto encodeStart = curr_time();
+    TraceScope outputTrace("output", "io");
+    std::vector<float> pixels(std::size_t(xres) * yres * channels);
+    {
+        TraceScope trace("resolve", "io");
+        parallelFor(0, yres, [&](int64_t y) {
+            Bounds2<int> row(Point2<int>(0, y), Point2<int>(xres, y + 1));
+            format.resolve(film, row, &pixels[std::size_t(y) * xres * channels], xres,
+                           denoised.empty() ? nullptr : denoised.data());
+        }, 16);
+    }
+
+    std::vector<uint16_t> halfPixels;
+    TypeDesc type;
+    {
+        TraceScope trace("encode", "io");
+        type = format.encode(pixels, halfPixels);
+    }
+    const void *data = (type == TypeDesc::HALF) ? (const void *)halfPixels.data() : pixels.data();
+
+    {
+        TraceScope trace("write image", "io");
+        std::unique_ptr<ImageOutput> out = ImageOutput::create(format.filename());
+        if (!out)
+            errorFatal("{}: {}", format.filename(), geterror());
+
+        // AOVs follow the image as further parts of a multipart EXR
+        std::vector<ImageSpec> specs = {format.spec(xres, yres)};
+        if (aovs) {
+            if (!out->supports("multiimage"))
+                errorFatal("{}: the format cannot hold AOV layers", format.filename());
+            auto aovSpecs = aovs->specs(specs[0]);
+            specs.insert(specs.end(), aovSpecs.begin(), aovSpecs.end());
+        }
+
+        // OpenEXR compresses on its own threads, see init()
+        if (!out->open(format.filename(), int(specs.size()), specs.data()) ||
+            !out->write_image(type, data) ||
+            (aovs && !aovs->write(*out, format.filename(), film)) || !out->close())
+            error("{}: {}", format.filename(), out->geterror());
+    }
+
+    reportOutput(format.filename(), diff_time<nanoseconds>(encodeStart, curr_time()).count());
+    return stats;
+}
+
+bool writeRenderStats(const RenderStats &stats, const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    const RayStats &r = stats.rays;
+    std::print(f, "{{\n  \"wall_ms\": {:.3f},\n  \"spp\": {},\n  \"passes\": {},\n", stats.wallNs / 1e6,
+               stats.samplesPerPixel, stats.passes);
+    std::print(f, "  \"camera_rays\": {},\n  \"secondary_rays\": {},\n  \"shadow_rays\": {},\n",
+               r.cameraRays, r.secondaryRays, r.shadowRays);
+    std::print(f, "  \"mrays_per_s\": {:.4g},\n", stats.wallNs > 0 ? r.totalRays() * 1e3 / stats.wallNs : 0.0);
+    std::print(f, "  \"busy_ms\": [");
+    for (std::size_t t = 0; t < stats.busyNs.size(); ++t)
+        std::print(f, "{}{:.3f}", t ? ", " : "", stats.busyNs[t] / 1e6);
+    std::print(f, "]\n}}\n");
+    if (fclose(f) != 0) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    return true;
 }
@@ -1,5 +1,22 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "../scene.hpp"
+#include "../util/stats.hpp"
+
+// what a render cost, for --stats-file and the benchmark modes
+struct RenderStats {
+    int64_t wallNs = 0;           // ray tracing only, not scene setup or output
+    int samplesPerPixel = 0;
+    int passes = 0;
+    RayStats rays;
+    std::vector<int64_t> busyNs;  // per pool thread, time spent rendering tiles
+};
+
+RenderStats render(const Scene &scene);
 
-void render(const Scene &scene);
+// stats as a JSON object
+bool writeRenderStats(const RenderStats &stats, const std::string &filename);
@@ -0,0 +1,97 @@
+#include "tiles.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+
+int hilbertIndex(int n, int x, int y) {
+    int d = 0;
+    for (int s = n / 2; s > 0; s /= 2) {
+        int rx = (x & s) > 0;
+        int ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // rotate the quadrant so the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+int adaptiveTileSize(int W, int H, int tileSize, int nThreads) {
+    auto nTiles = [&](int size) {
+        return ((W + size - 1) / size) * ((H + size - 1) / size);
+    };
+    while (tileSize > 8 && nTiles(tileSize) < 8 * nThreads)
+        tileSize /= 2;
+    return tileSize;
+}
+
+static void splitTiles(std::vector<Bounds2<int>> &tiles, int splitTail) {
+    int n = std::min<int>(splitTail, tiles.size());
+    std::vector<Bounds2<int>> tail(tiles.end() - n, tiles.end());
+    tiles.resize(tiles.size() - n);
+
+    for (const auto &t : tail) {
+        int w = t.pMax.x - t.pMin.x, h = t.pMax.y - t.pMin.y;
+        if (w < 8 || h < 8) {
+            tiles.push_back(t);
+            continue;
+        }
+
+        int mx = t.pMin.x + w / 2, my = t.pMin.y + h / 2;
+        tiles.push_back({Point2<int>(t.pMin.x, t.pMin.y), Point2<int>(mx, my)});
+        tiles.push_back({Point2<int>(mx, t.pMin.y), Point2<int>(t.pMax.x, my)});
+        tiles.push_back({Point2<int>(mx, my), Point2<int>(t.pMax.x, t.pMax.y)});
+        tiles.push_back({Point2<int>(t.pMin.x, my), Point2<int>(mx, t.pMax.y)});
+    }
+}
+
+std::vector<Bounds2<int>> makeTiles(int W, int H, int TILE, TileOrder order, int splitTail) {
+    std::vector<Bounds2<int>> tiles;
+    int tilesX = (W + TILE - 1) / TILE;
+    int tilesY = (H + TILE - 1) / TILE;
+
+    std::vector<Point2<int>> grid;
+    grid.reserve(tilesX * tilesY);
+    for (int ty = 0; ty < tilesY; ++ty)
+        for (int tx = 0; tx < tilesX; ++tx)
+            grid.push_back(Point2<int>(tx, ty));
+
+    if (order == TileOrder::Hilbert) {
+        int n = std::bit_ceil(unsigned(std::max(tilesX, tilesY)));
+        std::stable_sort(grid.begin(), grid.end(), [n](Point2<int> a, Point2<int> b) {
+            return hilbertIndex(n, a.x, a.y) < hilbertIndex(n, b.x, b.y);
+        });
+    } else if (order == TileOrder::Spiral) {
+        // ring by ring around the center tile, each ring walked by angle
+        Float cx = (tilesX - 1) / 2.0, cy = (tilesY - 1) / 2.0;
+        auto key = [cx, cy](Point2<int> p) {
+            Float dx = p.x - cx, dy = p.y - cy;
+            int ring = int(std::max(std::abs(dx), std::abs(dy)) + 0.5);
+            return std::pair(ring, std::atan2(dy, dx));
+        };
+        std::stable_sort(grid.begin(), grid.end(), [&key](Point2<int> a, Point2<int> b) {
+            return key(a) < key(b);
+        });
+    }
+
+    tiles.reserve(grid.size());
+    for (auto p : grid) {
+        int x0 = p.x * TILE;
+        int y0 = p.y * TILE;
+        int x1 = std::min(x0 + TILE, W);
+        int y1 = std::min(y0 + TILE, H);
+        tiles.push_back({Point2<int>(x0, y0), Point2<int>(x1, y1)});
+    }
+
+    if (splitTail > 0)
+        splitTiles(tiles, splitTail);
+
+    return tiles;
+}
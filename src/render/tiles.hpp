@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+
+#include "options.hpp"
+#include "util/vecmath.hpp"
+
+/*
+ * Image tiling for the render loop. Tiles come out in the order they should
+ * be handed to workers: along a Hilbert curve or spiralling out from the
+ * image center, so tiles rendered at the same time sit next to each other
+ * and share most of the scene they touch.
+ *
+ * The last `splitTail` tiles are cut into quarters so the final stretch of
+ * a frame is made of small pieces instead of a few expensive ones that
+ * leave every other core idle.
+ */
+std::vector<Bounds2<int>> makeTiles(int W, int H, int tileSize,
+                                    TileOrder order = TileOrder::RowMajor,
+                                    int splitTail = 0);
+
+// shrinks tileSize (by halves, down to 8) until there are at least 8 tiles per thread
+int adaptiveTileSize(int W, int H, int tileSize, int nThreads);
+
+// index of (x, y) along the Hilbert curve covering an n x n grid, n a power of two
+int hilbertIndex(int n, int x, int y);
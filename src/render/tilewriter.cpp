@@ -0,0 +1,117 @@
+#include "tilewriter.hpp"
+#include "util/error.hpp"
+#include "util/profiler.hpp"
+#include "util/trace.hpp"
+#include "util/timing.hpp"
+
+using namespace OIIO;
+
+TileWriter::TileWriter(const OutputFormat &format, Film &film, const Filter &filter,
+                       const std::vector<Bounds2<int>> &tiles)
+: format(format), film(film), filter(filter),
+  pixelsLeft(std::make_unique<std::atomic<int>[]>(film.numBlocks())), written(film.numBlocks(), false) {
+    for (int i = 0; i < film.numBlocks(); ++i)
+        pixelsLeft[i] = 0;
+    forEachBlock(tiles, [&](int block, int pixels) { pixelsLeft[block] += pixels; });
+
+    const std::string &filename = format.filename();
+    out = ImageOutput::create(filename);
+    if (!out || !out->supports("tiles"))
+        errorFatal("{}: no tiled output support: {}", filename, geterror());
+    if (!out->open(filename, format.spec(film.width(), film.height(), film.blockSize())))
+        errorFatal("{}: {}", filename, out->geterror());
+
+    writer = std::thread([this]() {
+        tracer.nameThread("tile writer");
+        writerLoop();
+    });
+}
+
+TileWriter::~TileWriter() {
+    finish();
+}
+
+template <typename F>
+void TileWriter::forEachBlock(const std::vector<Bounds2<int>> &tiles, F &&func) const {
+    int bs = film.blockSize(), blocksX = (film.width() + bs - 1) / bs;
+    for (const Bounds2<int> &t : tiles) {
+        Bounds2<int> padded = FilmTile::paddedBounds(t, filter, film.bounds());
+        for (int by = padded.pMin.y / bs; by <= (padded.pMax.y - 1) / bs; ++by)
+            for (int bx = padded.pMin.x / bs; bx <= (padded.pMax.x - 1) / bs; ++bx) {
+                int index = by * blocksX + bx;
+                func(index, intersect(padded, film.blockBounds(index)).area());
+            }
+    }
+}
+
+void TileWriter::tileDone(const Bounds2<int> &tile) {
+    forEachBlock({tile}, [&](int block, int pixels) {
+        if (pixelsLeft[block].fetch_sub(pixels, std::memory_order_acq_rel) == pixels) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(block);
+            }
+            ready.notify_one();
+        }
+    });
+}
+
+void TileWriter::finish() {
+    if (!writer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    ready.notify_one();
+    writer.join();
+
+    // blocks that never completed, written with whatever they hold
+    for (int i = 0; i < film.numBlocks(); ++i)
+        if (!written[i])
+            writeBlock(i);
+
+    auto start = curr_time();
+    if (!out->close())
+        error("{}: {}", format.filename(), out->geterror());
+    writeTimeNs += diff_time<nanoseconds>(start, curr_time()).count();
+}
+
+void TileWriter::writerLoop() {
+    while (true) {
+        int block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this]() { return done || !queue.empty(); });
+            if (queue.empty())
+                return;
+            block = queue.front();
+            queue.pop_front();
+        }
+        writeBlock(block);
+    }
+}
+
+void TileWriter::writeBlock(int block) {
+    PROFILE_SCOPE("TileWriter::writeBlock");
+    TraceScope trace("write block", "io");
+    trace.arg("block", block);
+    auto start = curr_time();
+
+    // EXR edge tiles are still passed as a full tile
+    int bs = film.blockSize(), channels = format.channels();
+    std::vector<float> pixels(std::size_t(bs) * bs * channels, 0.f);
+
+    Bounds2<int> b = film.blockBounds(block);
+    format.resolve(film, b, pixels.data(), bs);
+
+    TypeDesc type = format.encode(pixels, halfPixels);
+    const void *data = (type == TypeDesc::HALF) ? (const void *)halfPixels.data() : pixels.data();
+    if (!out->write_tile(b.pMin.x, b.pMin.y, 0, type, data))
+        error("{}: {}", format.filename(), out->geterror());
+
+    film.releaseBlock(block);
+    written[block] = true;
+    writeTimeNs += diff_time<nanoseconds>(start, curr_time()).count();
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <OpenImageIO/imageio.h>
+
+#include "film.hpp"
+#include "output.hpp"
+
+/*
+ * Streams a tiled EXR to disk while the frame is still rendering. The EXR
+ * tiles line up with the Film blocks; render threads report every finished
+ * tile through tileDone(), and once every render tile that splats into a
+ * block (its apron included) is merged, the block is queued for a dedicated
+ * writer thread that resolves, encodes and writes it, then releases its
+ * storage in the Film.
+ *
+ * Only valid for a single pass over the image: a block is written as soon
+ * as every pixel in it has been merged once.
+ */
+class TileWriter {
+public:
+    TileWriter(const OutputFormat &format, Film &film, const Filter &filter,
+               const std::vector<Bounds2<int>> &tiles);
+    ~TileWriter();
+
+    TileWriter(const TileWriter &) = delete;
+    TileWriter &operator=(const TileWriter &) = delete;
+
+    // called after the tile's samples are merged into the film, with the same
+    // bounds that were passed to the constructor
+    void tileDone(const Bounds2<int> &tile);
+
+    // writes whatever is still missing (e.g. after a cancelled render) and closes the file
+    void finish();
+
+    int64_t writeNs() const { return writeTimeNs; }
+
+private:
+    // calls func(block, pixels) for every block the padded tiles overlap
+    template <typename F>
+    void forEachBlock(const std::vector<Bounds2<int>> &tiles, F &&func) const;
+
+    void writerLoop();
+    void writeBlock(int block);
+
+    const OutputFormat &format;
+    Film &film;
+    const Filter &filter;
+    std::unique_ptr<OIIO::ImageOutput> out;
+    // splatted pixels still to be merged into each block
+    std::unique_ptr<std::atomic<int>[]> pixelsLeft;
+    std::vector<bool> written;  // writer thread only
+    std::vector<uint16_t> halfPixels;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> queue;
+    bool done = false;
+
+    std::thread writer;
+    int64_t writeTimeNs = 0;
+};
@@ -0,0 +1,58 @@
+#include "scene.hpp"
+#include "util/log.hpp"
+#include "util/numa.hpp"
+#include <thread>
+
+void Scene::applyOverrides() {
+    if (Options->spp > 0)
+        camera.samples_per_pixel = Options->spp;
+    if (Options->maxDepth > 0)
+        camera.max_depth = Options->maxDepth;
+    if (Options->width > 0) {
+        camera.image_width = Options->width;
+        camera.image_height = Options->height;
+    }
+}
+
+void Scene::placeForNuma() {
+    if (Options->numaPolicy == NumaPolicy::None)
+        return;
+
+    const NumaTopology &topo = numaTopology();
+    if (topo.numNodes() < 2) {
+        LOG_VERBOSE("Single NUMA node, ignoring NUMA policy");
+        return;
+    }
+
+    if (Options->numaPolicy == NumaPolicy::Interleave) {
+        // mbind() does nothing useful on a read-only file mapping, interleave a private copy
+        if (world.centers.mapped()) {
+            world.centers = MappedArray<Body>(world.centers);
+            LOG_VERBOSE("Copied {} mapped spheres into anonymous memory to interleave them",
+                        world.centers.size());
+        }
+        if (!interleavePages(world.centers.data(), world.centers.size() * sizeof(Body)))
+            warning("Unable to interleave scene memory: {}", errorString());
+        return;
+    }
+
+    // each copy is made by a thread running on its node, so its pages are allocated there
+    replicas.resize(topo.numNodes());
+    std::vector<std::thread> threads;
+    for (int node = 0; node < topo.numNodes(); ++node)
+        threads.emplace_back([this, node]() {
+            if (!pinThreadToNode(node))
+                warning("Unable to run on NUMA node {}, its scene copy may be remote", node);
+            replicas[node] = std::make_unique<const Spheres>(world);
+        });
+    for (auto &t : threads)
+        t.join();
+
+    LOG_VERBOSE("Replicated scene on {} NUMA nodes", topo.numNodes());
+}
+
+const Spheres &Scene::localWorld() const {
+    if (replicas.empty())
+        return world;
+    return *replicas[currentNumaNode()];
+}
@@ -1,14 +1,34 @@
 #pragma once
 
 #include "camera.h"
+#include "lights.hpp"
+#include "options.hpp"
 #include "sphere.h"
 
 struct Scene {
     Scene(Spheres list, camera cam)
-    : world(list), camera(cam) {
+    : world(std::move(list)), camera(cam) {
+        applyOverrides();
         camera.initialize();
+        if (!Options->envMap.empty())
+            envLight = EnvironmentLight::load(Options->envMap, Options->envMapScale);
+        placeForNuma();
     }
 
+    // the copy of world closest to the calling thread
+    const Spheres &localWorld() const;
+
     Spheres world;
     camera camera;
+    std::shared_ptr<EnvironmentLight> envLight;
+
+private:
+    // command line spp/resolution/depth settings replace the scene's own
+    void applyOverrides();
+
+    // applies Options->numaPolicy to world, a no-op on single node machines
+    void placeForNuma();
+
+    // per NUMA node copies of world under NumaPolicy::Replicate, otherwise empty
+    std::vector<std::unique_ptr<const Spheres>> replicas;
 };
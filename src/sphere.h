@@ -2,16 +2,36 @@
 
 #include "hittable.h"
 #include "ray.hpp"
+#include "util/memory.hpp"
 #include "util/vecmath.hpp"
+#include <cstdint>
 
 struct Body {
     Point3f center;
     Float radius;
 };
 
+/*
+ * Sphere geometry plus a table of the materials it uses. centers and
+ * materialIds may point straight into a mapped binary scene file.
+ */
 struct Spheres {
-    std::vector<Body> centers;
+    MappedArray<Body> centers;
+    MappedArray<uint32_t> materialIds;  // index into materials, per sphere
     std::vector<std::shared_ptr<material>> materials;
+
+    void add(const Body &body, uint32_t materialId) {
+        centers.push_back(body);
+        materialIds.push_back(materialId);
+    }
+
+    // adds a sphere with a material of its own
+    void add(const Body &body, std::shared_ptr<material> m) {
+        add(body, uint32_t(materials.size()));
+        materials.push_back(std::move(m));
+    }
+
+    std::size_t size() const { return centers.size(); }
 };
 
 inline bool hit(const Body &sphere, const Ray &r, 
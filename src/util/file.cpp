@@ -0,0 +1,18 @@
+#include "file.hpp"
+#include "error.hpp"
+#include <cstdio>
+
+std::string readFile(const std::string &filename) {
+    std::FILE *f = std::fopen(filename.c_str(), "rb");
+    if (!f)
+        errorFatal("{}: {}", filename, errorString());
+    std::string text;
+    std::fseek(f, 0, SEEK_END);
+    text.resize(std::ftell(f));
+    std::fseek(f, 0, SEEK_SET);
+    std::size_t n = std::fread(text.data(), 1, text.size(), f);
+    std::fclose(f);
+    if (n != text.size())
+        errorFatal("{}: short read", filename);
+    return text;
+}
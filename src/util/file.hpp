@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string>
+
+// the whole file as a string; errorFatal()s if it cannot be opened or fully read
+std::string readFile(const std::string &filename);
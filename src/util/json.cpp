@@ -0,0 +1,193 @@
+#include "json.hpp"
+#include "error.hpp"
+#include "file.hpp"
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+class JsonParser {
+public:
+    JsonParser(std::string_view text, std::string_view filename)
+    : pos(text.data()), end(text.data() + text.size()), lineStart(pos), filename(filename) {}
+
+    JsonValue parseDocument() {
+        JsonValue v = value();
+        skipSpace();
+        if (pos != end)
+            fail("unexpected '{}' after the document", *pos);
+        return v;
+    }
+
+private:
+    JsonValue value() {
+        skipSpace();
+        if (pos == end)
+            fail("unexpected end of file");
+
+        JsonValue v;
+        switch (*pos) {
+        case '{':
+            v.type = JsonValue::Type::Object;
+            ++pos;
+            if (peek('}'))
+                return v;
+            do {
+                skipSpace();
+                std::string key = string();
+                expect(':');
+                v.members.emplace_back(std::move(key), value());
+            } while (peek(','));
+            expect('}');
+            return v;
+        case '[':
+            v.type = JsonValue::Type::Array;
+            ++pos;
+            if (peek(']'))
+                return v;
+            do
+                v.items.push_back(value());
+            while (peek(','));
+            expect(']');
+            return v;
+        case '"':
+            v.type = JsonValue::Type::String;
+            v.str = string();
+            return v;
+        }
+
+        if (literal("true")) {
+            v.type = JsonValue::Type::Bool;
+            v.boolean = true;
+            return v;
+        }
+        if (literal("false")) {
+            v.type = JsonValue::Type::Bool;
+            return v;
+        }
+        if (literal("null"))
+            return v;
+
+        auto [next, ec] = std::from_chars(pos, end, v.num);
+        if (ec != std::errc())
+            fail("expected a value, got '{}'", *pos);
+        v.type = JsonValue::Type::Number;
+        pos = next;
+        return v;
+    }
+
+    std::string string() {
+        if (pos == end || *pos != '"')
+            fail("expected a string");
+        std::string s;
+        for (++pos; pos < end && *pos != '"'; ++pos) {
+            if (*pos != '\\') {
+                s += *pos;
+                continue;
+            }
+            if (++pos == end)
+                break;
+            switch (*pos) {
+            case 'n': s += '\n'; break;
+            case 't': s += '\t'; break;
+            case 'r': s += '\r'; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case '"': case '\\': case '/': s += *pos; break;
+            default: fail("unsupported escape '\\{}'", *pos);
+            }
+        }
+        if (pos == end)
+            fail("unterminated string");
+        ++pos;
+        return s;
+    }
+
+    bool literal(std::string_view word) {
+        if (std::size_t(end - pos) < word.size() || std::string_view(pos, word.size()) != word)
+            return false;
+        pos += word.size();
+        return true;
+    }
+
+    // consumes c if it is the next non-space character
+    bool peek(char c) {
+        skipSpace();
+        if (pos < end && *pos == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c) {
+        if (peek(c))
+            return;
+        if (pos == end)
+            fail("expected '{}' at the end of file", c);
+        fail("expected '{}', got '{}'", c, *pos);
+    }
+
+    void skipSpace() {
+        for (; pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'); ++pos)
+            if (*pos == '\n') {
+                ++line;
+                lineStart = pos + 1;
+            }
+    }
+
+    template <typename... Args>
+    [[noreturn]] void fail(std::format_string<Args...> fmt, Args &&...args) {
+        FileLoc loc(filename, line, int(pos - lineStart) + 1);
+        errorFatal(&loc, fmt, std::forward<Args>(args)...);
+    }
+
+    const char *pos, *end, *lineStart;
+    int line = 1;
+    std::string_view filename;
+};
+
+} // namespace
+
+const JsonValue *JsonValue::find(std::string_view key) const {
+    for (const auto &[k, v] : members)
+        if (k == key)
+            return &v;
+    return nullptr;
+}
+
+double JsonValue::number(std::string_view key, double fallback) const {
+    const JsonValue *v = find(key);
+    return v && v->isNumber() ? v->num : fallback;
+}
+
+std::string JsonValue::string(std::string_view key) const {
+    const JsonValue *v = find(key);
+    return v && v->type == Type::String ? v->str : std::string();
+}
+
+JsonValue parseJson(std::string_view text, std::string_view filename) {
+    return JsonParser(text, filename).parseDocument();
+}
+
+JsonValue loadJson(const std::string &filename) {
+    return parseJson(readFile(filename), filename);
+}
+
+std::string jsonQuote(std::string_view text) {
+    std::string s = "\"";
+    for (char c : text) {
+        switch (c) {
+        case '"': s += "\\\""; break;
+        case '\\': s += "\\\\"; break;
+        case '\n': s += "\\n"; break;
+        case '\t': s += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                s += std::format("\\u{:04x}", int(c));
+            else
+                s += c;
+        }
+    }
+    return s + "\"";
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Just enough JSON to read back the files this program writes, such as
+ * benchmark results and render stats: objects, arrays, numbers, strings
+ * (without \u escapes), true, false and null. Malformed input is
+ * errorFatal()ed with its line and column.
+ */
+struct JsonValue {
+    enum class Type {Null, Bool, Number, String, Array, Object};
+
+    // member by key, nullptr if this is not an object or has no such key
+    const JsonValue *find(std::string_view key) const;
+    // numeric member, fallback if missing or not a number
+    double number(std::string_view key, double fallback) const;
+    // string member, empty if missing or not a string
+    std::string string(std::string_view key) const;
+
+    bool isNumber() const { return type == Type::Number; }
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double num = 0;
+    std::string str;
+    std::vector<JsonValue> items;                           // arrays
+    std::vector<std::pair<std::string, JsonValue>> members;  // objects, in file order
+};
+
+JsonValue parseJson(std::string_view text, std::string_view filename);
+JsonValue loadJson(const std::string &filename);
+
+// text as a JSON string literal, quotes included
+std::string jsonQuote(std::string_view text);
@@ -76,6 +76,15 @@ std::string toString(LogLevel level, bool colored) {
     }
 }
 
+LogLevel logLevelFromString(const std::string &s) {
+    if (s == "verbose") return LogLevel::Verbose;
+    if (s == "warning") return LogLevel::Warning;
+    if (s == "error")   return LogLevel::Error;
+    if (s == "debug")   return LogLevel::Debug;
+    if (s == "fatal")   return LogLevel::Fatal;
+    return LogLevel::Invalid;
+}
+
 void log(LogLevel level, const char *file, int line, const std::string &s) {
     if (s.empty())
         return;
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+
+inline constexpr std::size_t CacheLineSize = 64;
+
+/*
+ * Fixed-size, cache line aligned array of trivially copyable values.
+ * Unlike std::vector it does not value-initialize, so the pages are first
+ * touched by whichever thread writes them first, not by the allocating one.
+ */
+template <typename T>
+class AlignedArray {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    AlignedArray() = default;
+    explicit AlignedArray(std::size_t n) { allocate(n); }
+    ~AlignedArray() { release(); }
+
+    AlignedArray(const AlignedArray &) = delete;
+    AlignedArray &operator=(const AlignedArray &) = delete;
+
+    AlignedArray(AlignedArray &&o) noexcept : ptr(std::exchange(o.ptr, nullptr)), n(std::exchange(o.n, 0)) {}
+    AlignedArray &operator=(AlignedArray &&o) noexcept {
+        if (this != &o) {
+            release();
+            ptr = std::exchange(o.ptr, nullptr);
+            n = std::exchange(o.n, 0);
+        }
+        return *this;
+    }
+
+    // grows to at least n elements; contents are unspecified afterwards
+    void allocate(std::size_t count) {
+        if (count <= n)
+            return;
+        release();
+        ptr = static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(CacheLineSize)));
+        n = count;
+    }
+
+    void release() {
+        if (ptr)
+            ::operator delete(ptr, std::align_val_t(CacheLineSize));
+        ptr = nullptr;
+        n = 0;
+    }
+
+    void zero() {
+        if (ptr)
+            std::memset(static_cast<void *>(ptr), 0, n * sizeof(T));
+    }
+
+    T &operator[](std::size_t i) {
+        DCHECK_LT(i, n);
+        return ptr[i];
+    }
+    const T &operator[](std::size_t i) const {
+        DCHECK_LT(i, n);
+        return ptr[i];
+    }
+
+    T *data() { return ptr; }
+    const T *data() const { return ptr; }
+    std::size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+private:
+    T *ptr = nullptr;
+    std::size_t n = 0;
+};
+
+/*
+ * Growable array of trivially copyable values that can also view memory it
+ * does not own, such as a mapped scene file. A view keeps its owner alive
+ * through a shared_ptr and is read-only; copies of either kind own their
+ * elements.
+ */
+template <typename T>
+class MappedArray {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    MappedArray() = default;
+    MappedArray(std::vector<T> v) : owned(std::move(v)) { sync(); }
+    MappedArray(const T *p, std::size_t count, std::shared_ptr<const void> owner)
+    : ptr(p), n(count), owner(std::move(owner)) {}
+
+    MappedArray(const MappedArray &o) : owned(o.begin(), o.end()) { sync(); }
+    MappedArray &operator=(const MappedArray &o) {
+        if (this != &o) {
+            owned.assign(o.begin(), o.end());
+            owner.reset();
+            sync();
+        }
+        return *this;
+    }
+
+    // moving a vector keeps its buffer, so ptr stays valid either way
+    MappedArray(MappedArray &&o) noexcept
+    : owned(std::move(o.owned)), ptr(std::exchange(o.ptr, nullptr)), n(std::exchange(o.n, 0)),
+      owner(std::move(o.owner)) {}
+    MappedArray &operator=(MappedArray &&o) noexcept {
+        owned = std::move(o.owned);
+        ptr = std::exchange(o.ptr, nullptr);
+        n = std::exchange(o.n, 0);
+        owner = std::move(o.owner);
+        return *this;
+    }
+
+    void push_back(const T &v) {
+        DCHECK(!mapped());
+        owned.push_back(v);
+        sync();
+    }
+    void reserve(std::size_t count) {
+        DCHECK(!mapped());
+        owned.reserve(count);
+        sync();
+    }
+
+    const T &operator[](std::size_t i) const {
+        DCHECK_LT(i, n);
+        return ptr[i];
+    }
+
+    const T *data() const { return ptr; }
+    const T *begin() const { return ptr; }
+    const T *end() const { return ptr + n; }
+    std::size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    bool mapped() const { return owner != nullptr; }
+
+private:
+    void sync() {
+        ptr = owned.data();
+        n = owned.size();
+    }
+
+    std::vector<T> owned;
+    const T *ptr = nullptr;
+    std::size_t n = 0;
+    std::shared_ptr<const void> owner;
+};
@@ -0,0 +1,197 @@
+#include "numa.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static thread_local int pinnedNode = -1;
+
+#ifdef __linux__
+
+// parses sysfs cpu lists such as "0-7,16-23"
+static std::vector<int> parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+        auto dash = range.find('-');
+        int lo = std::stoi(range.substr(0, dash));
+        int hi = (dash == std::string::npos) ? lo : std::stoi(range.substr(dash + 1));
+        for (int c = lo; c <= hi; ++c)
+            cpus.push_back(c);
+    }
+    return cpus;
+}
+
+static NumaTopology readTopology() {
+    NumaTopology topo;
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        for (int c = 0; c < int(std::thread::hardware_concurrency()); ++c)
+            CPU_SET(c, &allowed);
+
+    topo.cpuNode.assign(CPU_SETSIZE, -1);
+
+    // node ids can have holes, e.g. after hot-unplug
+    for (int node = 0; node < 256; ++node) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!in)
+            continue;
+
+        std::string list;
+        std::getline(in, list);
+
+        std::vector<int> cpus;
+        for (int c : parseCpuList(list))
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+                cpus.push_back(c);
+
+        // memory-only nodes and nodes outside our cpuset get no threads
+        if (cpus.empty())
+            continue;
+
+        for (int c : cpus)
+            topo.cpuNode[c] = topo.numNodes();
+        topo.nodeIds.push_back(node);
+        topo.nodeCpus.push_back(std::move(cpus));
+    }
+
+    if (topo.nodeCpus.empty()) {
+        std::vector<int> cpus;
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &allowed)) {
+                cpus.push_back(c);
+                topo.cpuNode[c] = 0;
+            }
+        topo.nodeIds.push_back(0);
+        topo.nodeCpus.push_back(std::move(cpus));
+    }
+
+    return topo;
+}
+
+#else
+
+static NumaTopology readTopology() {
+    NumaTopology topo;
+    int n = std::max(1u, std::thread::hardware_concurrency());
+    topo.nodeIds.push_back(0);
+    topo.nodeCpus.emplace_back();
+    for (int c = 0; c < n; ++c) {
+        topo.nodeCpus[0].push_back(c);
+        topo.cpuNode.push_back(0);
+    }
+    return topo;
+}
+
+#endif
+
+const NumaTopology &numaTopology() {
+    static const NumaTopology topo = readTopology();
+    return topo;
+}
+
+int cpuForThread(int threadIndex) {
+    const NumaTopology &topo = numaTopology();
+
+    std::size_t total = 0;
+    for (const auto &cpus : topo.nodeCpus)
+        total += cpus.size();
+
+    std::size_t i = std::size_t(threadIndex) % total;
+    int node = int(i % topo.numNodes());
+    std::size_t slot = i / topo.numNodes();
+
+    // nodes with fewer CPUs run out first, hand their slots to the next node
+    while (slot >= topo.nodeCpus[node].size()) {
+        slot -= topo.nodeCpus[node].size();
+        node = (node + 1) % topo.numNodes();
+    }
+    return topo.nodeCpus[node][slot];
+}
+
+bool pinThreadToCpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        return false;
+    pinnedNode = numaTopology().cpuNode[cpu];
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool pinThreadToNode(int node) {
+#ifdef __linux__
+    const NumaTopology &topo = numaTopology();
+    if (node < 0 || node >= topo.numNodes())
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : topo.nodeCpus[node])
+        CPU_SET(c, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        return false;
+    pinnedNode = node;
+    return true;
+#else
+    return false;
+#endif
+}
+
+int currentNumaNode() {
+    if (pinnedNode >= 0)
+        return pinnedNode;
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    const NumaTopology &topo = numaTopology();
+    if (cpu >= 0 && cpu < int(topo.cpuNode.size()) && topo.cpuNode[cpu] >= 0)
+        return topo.cpuNode[cpu];
+#endif
+    return 0;
+}
+
+bool interleavePages(const void *p, std::size_t bytes) {
+#ifdef __linux__
+    const NumaTopology &topo = numaTopology();
+    if (topo.numNodes() < 2 || bytes == 0)
+        return false;
+
+    // MPOL_INTERLEAVE and MPOL_MF_MOVE from <numaif.h>, which needs libnuma
+    constexpr int mpolInterleave = 3;
+    constexpr unsigned mpolMfMove = 1 << 1;
+
+    unsigned long mask = 0;
+    for (int id : topo.nodeIds)
+        if (id < int(8 * sizeof(mask)))
+            mask |= 1ul << id;
+
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    auto begin = reinterpret_cast<std::uintptr_t>(p) & ~(page - 1);
+    auto end = (reinterpret_cast<std::uintptr_t>(p) + bytes + page - 1) & ~(page - 1);
+
+    return syscall(SYS_mbind, begin, end - begin, mpolInterleave, &mask,
+                   8 * sizeof(mask), mpolMfMove) == 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * CPU and NUMA node topology, read from /sys on Linux. Everywhere else, or
+ * when /sys is not readable, the machine looks like one node holding every
+ * CPU and the placement calls below are no-ops that return false.
+ */
+struct NumaTopology {
+    // CPUs of each node this process is allowed to run on
+    std::vector<std::vector<int>> nodeCpus;
+    // kernel node id of each entry in nodeCpus
+    std::vector<int> nodeIds;
+    // index into nodeCpus of every CPU id, -1 for CPUs we cannot run on
+    std::vector<int> cpuNode;
+
+    int numNodes() const { return int(nodeCpus.size()); }
+};
+
+const NumaTopology &numaTopology();
+
+// CPU for pool thread i, alternating between nodes so each one gets an even share
+int cpuForThread(int threadIndex);
+
+bool pinThreadToCpu(int cpu);
+bool pinThreadToNode(int node);
+
+// node of the CPU the calling thread runs on, cached once the thread is pinned
+int currentNumaNode();
+
+// spread the pages covering [p, p + bytes) round-robin over all nodes
+bool interleavePages(const void *p, std::size_t bytes);
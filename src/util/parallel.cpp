@@ -0,0 +1,105 @@
+#include "parallel.hpp"
+#include "check.h"
+#include "error.hpp"
+#include "numa.hpp"
+#include "trace.hpp"
+#include <format>
+
+ThreadPool *threadPool = nullptr;
+
+thread_local int ThreadPool::index = -1;
+
+ThreadPool::ThreadPool(int nThreads, bool pinThreads) {
+    nThreads = std::max(nThreads, 1);
+    index = 0;
+
+    queues.reserve(nThreads);
+    for (int i = 0; i < nThreads; ++i)
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    threads.reserve(nThreads - 1);
+    for (int i = 1; i < nThreads; ++i)
+        threads.emplace_back([this, i, pinThreads]() { workerLoop(i, pinThreads); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        shutdown = true;
+    }
+    wake.notify_all();
+
+    for (auto &t : threads)
+        t.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    WorkQueue &q = *queues[std::max(index, 0)];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pending.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::notifyAll() {
+    // taking the lock orders this after a sleeper's check of its condition
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wake.notify_all();
+}
+
+bool ThreadPool::pop(int queueIndex, std::function<void()> &task, bool back) {
+    WorkQueue &q = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+
+    if (back) {
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+    } else {
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+    }
+    return true;
+}
+
+bool ThreadPool::runOne() {
+    if (!inPool() || pending.load(std::memory_order_relaxed) == 0)
+        return false;
+
+    std::function<void()> task;
+    bool found = pop(index, task, true);
+
+    for (int k = 1; !found && k < size(); ++k)
+        found = pop((index + k) % size(), task, false);
+
+    if (!found)
+        return false;
+
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(int workerIndex, bool pin) {
+    index = workerIndex;
+    tracer.nameThread(std::format("worker {}", workerIndex));
+    if (pin && !pinThreadToCpu(cpuForThread(workerIndex)) && workerIndex == 1)
+        warning("Unable to pin worker threads, running unpinned");
+
+    while (true) {
+        if (runOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return shutdown || pending.load(std::memory_order_relaxed) > 0; });
+        if (shutdown)
+            return;
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vecmath.hpp"
+
+/*
+ * Persistent pool of worker threads, created once in init(). Every thread
+ * that runs tasks owns a deque: it pushes and pops its own work at the back
+ * and, when that runs dry, steals from the front of the other deques, which
+ * is where the largest pieces of a recursively split range end up.
+ *
+ * The thread that creates the pool takes part in it as slot 0. A thread
+ * waiting on a TaskGroup runs queued tasks until there are none left and
+ * only then sleeps, so fork/join can nest freely.
+ *
+ * Other threads (the tile writer, the checkpointer) stay outside the pool:
+ * they never run queued tasks and their parallelFor calls run serially, so
+ * per-thread slots indexed by threadIndex() are never shared.
+ */
+class ThreadPool {
+public:
+    // nThreads counts the calling thread, so nThreads - 1 workers are spawned.
+    // With pinThreads every worker is bound to one CPU. The caller is left
+    // alone, threads it starts later inherit its affinity.
+    explicit ThreadPool(int nThreads, bool pinThreads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const { return int(queues.size()); }
+
+    void submit(std::function<void()> task);
+
+    // run one queued task if there is one, own deque first, then steal
+    bool runOne();
+
+    // runs queued tasks until done() holds, sleeping while there are none;
+    // whoever makes done() true must call notifyAll() afterwards
+    template <typename Done>
+    void helpUntil(Done &&done) {
+        while (!done()) {
+            if (runOne())
+                continue;
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [&]() { return done() || pending.load(std::memory_order_relaxed) > 0; });
+        }
+    }
+
+    void notifyAll();
+
+    // 0 for the thread that created the pool, 1..size()-1 for workers,
+    // -1 for threads outside the pool
+    static int threadIndex() { return index; }
+    static bool inPool() { return index >= 0; }
+
+private:
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(int workerIndex, bool pin);
+    bool pop(int queueIndex, std::function<void()> &task, bool back);
+
+    static thread_local int index;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<int> pending{0};
+    bool shutdown = false;
+};
+
+extern ThreadPool *threadPool;
+
+// fork/join: run() forks a task, wait() (or the destructor) joins all of them
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool *pool = threadPool) : pool(pool) {}
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    template <typename F>
+    void run(F &&f) {
+        if (!pool || !ThreadPool::inPool()) {
+            f();
+            return;
+        }
+        outstanding.fetch_add(1, std::memory_order_relaxed);
+        pool->submit([this, f = std::forward<F>(f)]() mutable {
+            f();
+            // the group may be gone as soon as the count reaches 0
+            ThreadPool *p = pool;
+            if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                p->notifyAll();
+        });
+    }
+
+    void wait() {
+        if (pool)
+            pool->helpUntil([this]() { return outstanding.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    ThreadPool *pool;
+    std::atomic<int> outstanding{0};
+};
+
+namespace detail {
+
+template <typename F>
+void parallelForRange(TaskGroup &group, int64_t begin, int64_t end, int64_t chunkSize, F &func) {
+    // keep the front half, hand the back half to whoever steals it
+    while (end - begin > chunkSize) {
+        int64_t mid = begin + (end - begin) / 2;
+        group.run([&group, &func, mid, end, chunkSize]() {
+            parallelForRange(group, mid, end, chunkSize, func);
+        });
+        end = mid;
+    }
+    for (int64_t i = begin; i < end; ++i)
+        func(i);
+}
+
+} // namespace detail
+
+// calls func(i) for every i in [begin, end), runs serially without a pool
+// or on a thread outside it
+template <typename F>
+void parallelFor(int64_t begin, int64_t end, F &&func, int64_t chunkSize = 1) {
+    if (end <= begin)
+        return;
+    if (!threadPool || threadPool->size() == 1 || !ThreadPool::inPool() || end - begin <= chunkSize) {
+        for (int64_t i = begin; i < end; ++i)
+            func(i);
+        return;
+    }
+
+    TaskGroup group;
+    detail::parallelForRange(group, begin, end, std::max<int64_t>(chunkSize, 1), func);
+    group.wait();
+}
+
+// calls func(i) for every i in [begin, end), started in increasing order: every
+// thread takes the next index from a shared counter, so work that is ordered
+// for locality (tiles along a curve) runs in that order
+template <typename F>
+void parallelForOrdered(int64_t begin, int64_t end, F &&func) {
+    if (end <= begin)
+        return;
+    if (!threadPool || threadPool->size() == 1 || !ThreadPool::inPool() || end - begin == 1) {
+        for (int64_t i = begin; i < end; ++i)
+            func(i);
+        return;
+    }
+
+    std::atomic<int64_t> next{begin};
+    auto work = [&]() {
+        for (int64_t i = next.fetch_add(1, std::memory_order_relaxed); i < end;
+             i = next.fetch_add(1, std::memory_order_relaxed))
+            func(i);
+    };
+    TaskGroup group;
+    int64_t helpers = std::min<int64_t>(threadPool->size(), end - begin) - 1;
+    for (int64_t t = 0; t < helpers; ++t)
+        group.run(work);
+    work();
+    group.wait();
+}
+
+// calls func(tile) for every tileSize x tileSize block of extent, in row-major order
+template <typename F>
+void parallelFor2D(const Bounds2<int> &extent, int tileSize, F &&func) {
+    int nx = (extent.pMax.x - extent.pMin.x + tileSize - 1) / tileSize;
+    int ny = (extent.pMax.y - extent.pMin.y + tileSize - 1) / tileSize;
+
+    parallelFor(0, int64_t(nx) * ny, [&](int64_t i) {
+        int x0 = extent.pMin.x + int(i % nx) * tileSize;
+        int y0 = extent.pMin.y + int(i / nx) * tileSize;
+        Bounds2<int> tile(Point2<int>(x0, y0),
+                          Point2<int>(std::min(x0 + tileSize, extent.pMax.x),
+                                      std::min(y0 + tileSize, extent.pMax.y)));
+        func(tile);
+    });
+}
@@ -0,0 +1,121 @@
+#include "perfcounters.hpp"
+#include "error.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+struct EventDesc {
+    PerfEvent event;
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+}
+
+// the first event that opens leads the group
+constexpr EventDesc events[] = {
+    {PerfEvent::Cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PerfEvent::Instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PerfEvent::BranchMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PerfEvent::L1dMisses, PERF_TYPE_HW_CACHE,
+     cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PerfEvent::LlcMisses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+static_assert(std::size(events) == PerfValues::count);
+
+int perfEventOpen(perf_event_attr &attr, int groupFd) {
+    // this thread, any cpu
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+}  // namespace
+
+bool PerfCounters::open(std::string *error) {
+    close();
+    int firstErrno = 0;
+    for (const EventDesc &e : events) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = e.type;
+        attr.config = e.config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // events that fail to open are skipped; the first one that opens leads the group
+        int fd = perfEventOpen(attr, leader);
+        if (fd < 0) {
+            if (!firstErrno)
+                firstErrno = errno;
+            continue;
+        }
+        if (leader < 0)
+            leader = fd;
+        fds[int(e.event)] = fd;
+        ++nOpen;
+    }
+
+    if (nOpen == 0 && error)
+        *error = errorString(firstErrno);
+    return nOpen > 0;
+}
+
+void PerfCounters::close() {
+    for (int &fd : fds)
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    leader = -1;
+    nOpen = 0;
+}
+
+PerfValues PerfCounters::read() const {
+    PerfValues values;
+    if (leader < 0)
+        return values;
+
+    // nr, time enabled, time running, then the values in the order the
+    // events joined the group, which is the order of the table
+    uint64_t buf[3 + PerfValues::count];
+    if (::read(leader, buf, sizeof(buf)) < ssize_t(3 * sizeof(uint64_t)))
+        return values;
+    uint64_t nr = buf[0], enabled = buf[1], running = buf[2];
+    if (running == 0)
+        return values;
+    double scale = double(enabled) / double(running);
+
+    uint64_t i = 0;
+    for (const EventDesc &e : events) {
+        if (fds[int(e.event)] < 0)
+            continue;
+        if (i >= nr)
+            break;
+        uint64_t value = buf[3 + i++];
+        values.v[int(e.event)] = running < enabled ? uint64_t(value * scale) : value;
+    }
+    return values;
+}
+
+#else
+
+bool PerfCounters::open(std::string *error) {
+    if (error)
+        *error = "perf_event_open is only available on Linux";
+    return false;
+}
+
+void PerfCounters::close() {}
+
+PerfValues PerfCounters::read() const { return {}; }
+
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+ * Per-thread hardware counters read through Linux perf_event_open. The
+ * events are opened for the calling thread, user space only, as one group
+ * that is read with one syscall: cycles, instructions and branch, L1 data
+ * and last level cache misses. Misses are meant per instruction, so no
+ * access counts are needed and the group fits the general purpose counters
+ * of current x86 cores even with SMT; every event still takes one file
+ * descriptor, five per counting thread.
+ *
+ * Events the machine lacks are left out; containers and VMs often have
+ * none at all, or forbid them through /proc/sys/kernel/perf_event_paranoid,
+ * and then open() fails and reading gives zeros.
+ */
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    L1dMisses,
+    LlcMisses,
+    Count
+};
+
+struct PerfValues {
+    static constexpr int count = int(PerfEvent::Count);
+
+    uint64_t operator[](PerfEvent e) const { return v[int(e)]; }
+    PerfValues &operator+=(const PerfValues &o) {
+        for (int i = 0; i < count; ++i)
+            v[i] += o.v[i];
+        return *this;
+    }
+    PerfValues operator-(const PerfValues &o) const {
+        PerfValues d;
+        for (int i = 0; i < count; ++i)
+            d.v[i] = v[i] - o.v[i];
+        return d;
+    }
+
+    std::array<uint64_t, count> v{};
+};
+
+class PerfCounters {
+public:
+    PerfCounters() { fds.fill(-1); }
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // opens the counters for the calling thread; false if none could be
+    // opened, with the reason in error
+    bool open(std::string *error = nullptr);
+    void close();
+
+    bool isOpen() const { return nOpen > 0; }
+    bool has(PerfEvent e) const { return fds[int(e)] >= 0; }
+
+    // counts since open(), scaled up if the kernel multiplexed a group
+    PerfValues read() const;
+
+private:
+    std::array<int, PerfValues::count> fds;
+    int leader = -1;
+    int nOpen = 0;
+};
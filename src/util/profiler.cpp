@@ -3,94 +3,164 @@
 #include <chrono>
 #include <format>
 #include <functional>
+#include <map>
 #include <print>
 
 #include "profiler.hpp"
 #include "check.h"
+#include "error.hpp"
 #include "log.hpp"
 #include "math.hpp"
 #include "timing.hpp"
 
-SampleHandle sample_start(std::string_view sampleName) {
-    if (!profiler.profiling) return nullptr;
-    DCHECK(!sampleName.empty());
-    DCHECK(!profiler.stack.empty());
-
-    const int parentId = profiler.stack.back();
-
-    auto it = profiler.samples.find(sampleName);
-    if (it == profiler.samples.end())
-        it = profiler.samples.try_emplace(std::string(sampleName), Profiler::Bucket{}).first;
-
-    auto &bucket = it->second;
+void Profiler::ThreadSamples::reset() {
+    nodes.assign(1, Node{});
+    stack.clear();
+    stack.reserve(32);
+    stack.push_back({0, 0});
+}
 
-    auto [sit, inserted] = bucket.try_emplace(parentId, Sample{});
-    Sample &s = sit->second;
+int Profiler::ThreadSamples::addNode(int scope, int parent) {
+    int node = int(nodes.size());
+    Node &n = nodes.emplace_back();
+    n.scope = scope;
+    n.parent = parent;
+    std::vector<int> &kids = nodes[parent].children;
+    if (scope >= int(kids.size()))
+        kids.resize(scope + 1, 0);
+    kids[scope] = node;
+    return node;
+}
 
-    if (inserted) {
-        s.index = profiler.currIndex++;
-        s.parent = parentId;
-    } else {
-        DCHECK(!s.alive);
-        DCHECK_EQ(s.parent, parentId);
+void Profiler::init(ProfileClock c, bool counters) {
+    std::lock_guard<std::mutex> lock(mutex);
+#if !defined(__x86_64__) && !defined(__i386__)
+    if (c == ProfileClock::Tsc) {
+        warning("No cycle counter on this platform, profiling with the steady clock");
+        c = ProfileClock::Steady;
+    }
+#endif
+#ifndef __linux__
+    if (c == ProfileClock::Coarse) {
+        warning("No coarse clock on this platform, profiling with the steady clock");
+        c = ProfileClock::Steady;
+    }
+#endif
+    clock = c;
+    counting = false;
+    if (counters) {
+        PerfCounters probe;
+        std::string why;
+        if (probe.open(&why))
+            counting = true;
+        else
+            warning("Hardware counters are unavailable ({}), profiling without them; containers and "
+                    "kernel.perf_event_paranoid > 2 commonly forbid them", why);
     }
+    profiling = true;
+    firstTick = curr_time();
+    firstClockTick = now();
+    for (auto &t : threads)
+        t->reset();
+}
 
-    s.alive = true;
-    profiler.stack.push_back(s.index);
-    s.lastTick = curr_time();
+int Profiler::registerScope(std::string_view name) {
+    DCHECK(!name.empty());
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = scopeIds.find(name);
+    if (it != scopeIds.end())
+        return it->second;
+    scopeNames.emplace_back(name);
+    return scopeIds.emplace(std::string(name), int(scopeNames.size()) - 1).first->second;
+}
 
-    return SampleHandle(&s, sampleDeleter);
+void Profiler::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<ThreadSamples>());
+    current = threads.back().get();
+    current->id = int(threads.size()) - 1;
+    current->reset();
 }
 
-void sample_end(Sample* sample) {
-    if (!profiler.profiling) return;
-    CHECK(sample);
-    CHECK(sample->alive);
-    CHECK(!profiler.stack.empty());
-    DCHECK_EQ(profiler.stack.back(), sample->index);
+std::vector<Profiler::Entry> Profiler::mergeTrees(const std::vector<const ThreadSamples *> &trees) const {
+    std::vector<Entry> entries(1);
+    std::map<std::pair<int, int>, int> byPath;
+    uint64_t t1 = now();
+
+    for (const ThreadSamples *t : trees) {
+        // parents are created before their children, so walking the nodes
+        // in order always finds the parent already merged
+        std::vector<int> merged(t->nodes.size(), 0);
+        for (int i = 1; i < int(t->nodes.size()); ++i) {
+            const Node &n = t->nodes[i];
+            int parent = merged[n.parent];
+            auto [it, inserted] = byPath.try_emplace({parent, n.scope}, int(entries.size()));
+            if (inserted) {
+                Entry &e = entries.emplace_back();
+                e.name = scopeNames[n.scope];
+                e.parent = parent;
+            }
+            merged[i] = it->second;
+
+            entries[it->second].calls += n.calls;
+            entries[it->second].ticks += n.ticks;
+            if (n.counted) {
+                entries[it->second].counted = true;
+                entries[it->second].counts += n.counts;
+            }
+        }
 
-    profiler.stack.pop_back();
-    sample->alive = false;
+        // scopes still open, e.g. the one around main() calling print()
+        for (std::size_t f = 1; f < t->stack.size(); ++f)
+            entries[merged[t->stack[f].node]].ticks += t1 - t->stack[f].start;
+    }
+    return entries;
+}
 
-    ++sample->calls;
-    sample->timeAlive += curr_time() - sample->lastTick;
+std::vector<Profiler::Entry> Profiler::merged() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<const ThreadSamples *> all;
+    for (const auto &t : threads)
+        all.push_back(t.get());
+    return mergeTrees(all);
 }
 
-void Profiler::print(bool sortByTime) {
+void Profiler::print(bool sortByTime, bool perThread) {
     if (!profiling) {
         LOG_WARNING("Ignoring Profiler::print(), profiler deactivated");
         return;
     }
 
-    auto totalDur = curr_time() - firstTick;
+    // the tsc rate is calibrated against the steady clock over the whole run
+    double seconds = std::chrono::duration<double>(curr_time() - firstTick).count();
+    double secondsPerTick = 1e-9;
+    if (clock == ProfileClock::Tsc && now() > firstClockTick)
+        secondsPerTick = seconds / double(now() - firstClockTick);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<const ThreadSamples *> all;
+    for (const auto &t : threads)
+        all.push_back(t.get());
+
+    printTree(mergeTrees(all), std::format("all threads ({})", all.size()), sortByTime, secondsPerTick);
+    if (perThread)
+        for (const ThreadSamples *t : all)
+            printTree(mergeTrees({t}), std::format("thread {}", t->id), sortByTime, secondsPerTick);
+}
 
-    struct Entry {
-        std::string_view name;
-        const Sample *s;
-        int parent;
-    };
+void Profiler::printTree(const std::vector<Entry> &nodes, const std::string &heading, bool sortByTime,
+                         double secondsPerTick) const {
+    auto totalDur = curr_time() - firstTick;
 
-    std::vector<Entry> entries;
-    std::map<int, std::size_t> byIndex;
     std::map<int, std::vector<int>> children;
-
-    entries.reserve(1024);
-
-    for (const auto &[name, bucket] : samples) {
-        for (const auto &[parentId, s] : bucket) {
-            CHECK(s.index > 0);
-            byIndex[s.index] = entries.size();
-            entries.push_back(Entry{name, &s, s.parent});
-            children[s.parent].push_back(s.index);
-        }
-    }
+    for (int i = 1; i < int(nodes.size()); ++i)
+        children[nodes[i].parent].push_back(i);
 
     for (auto& [p, kids] : children) {
         if (sortByTime) {
             std::sort(kids.begin(), kids.end(),
-                      [&byIndex, &entries](int a, int b) {
-                      return entries.at(byIndex.at(a)).s->calls >
-                      entries.at(byIndex.at(b)).s->calls;
+                      [&nodes](int a, int b) {
+                      return nodes[a].calls > nodes[b].calls;
                       });
         } else {
             std::sort(kids.begin(), kids.end());
@@ -108,32 +178,42 @@ void Profiler::print(bool sortByTime) {
         if (it == children.end()) return;
 
         for (int childIdx : it->second) {
-            auto eIt = byIndex.find(childIdx);
-            if (eIt == byIndex.end()) continue;
-            const Entry &e = entries[eIt->second];
-
-            nameWidth = std::max<int>(nameWidth, depth * 2 + (int)e.name.size());
+            nameWidth = std::max<int>(nameWidth, depth * 2 + (int)nodes[childIdx].name.size());
             compute_width(childIdx, depth + 1);
         }
     };
 
     compute_width(0, 0);
 
-    auto print_node = [&](const Entry& e, int depth) {
-        auto dur = e.s->timeAlive;
-        if (e.s->alive) dur += (curr_time() - e.s->lastTick);
+    bool anyCounted = std::any_of(nodes.begin(), nodes.end(), [](const Entry &e) { return e.counted; });
+    auto ratio = [](double num, uint64_t den) {
+        if (den == 0)
+            return std::format("{:>9}", "-");
+        return std::format("{:>9.2f}", num / den);
+    };
+    // instructions per cycle, then misses per thousand instructions
+    auto counterColumns = [&](const Entry &n) -> std::string {
+        if (!n.counted)
+            return "";
+        const PerfValues &c = n.counts;
+        uint64_t instructions = c[PerfEvent::Instructions];
+        return " " + ratio(instructions, c[PerfEvent::Cycles]) +
+               " " + ratio(1000.0 * c[PerfEvent::L1dMisses], instructions) +
+               " " + ratio(1000.0 * c[PerfEvent::LlcMisses], instructions) +
+               " " + ratio(1000.0 * c[PerfEvent::BranchMisses], instructions);
+    };
 
-        double aliveSec = std::chrono::duration<double>(dur).count();
+    auto print_node = [&](const Entry& n, int depth) {
+        double aliveSec = n.ticks * secondsPerTick;
         double totalSec = std::chrono::duration<double>(totalDur).count();
         double proportion = (totalSec > 0.0) ? (aliveSec / totalSec) : 0.0;
 
-        std::string n = name_with_indent(e.name, depth);
-
-        std::print(stderr, "  {:<{}} {:>9} {:>14.3f} {:>9.2f}%\n",
-                   n, nameWidth + 2,
-                   e.s->calls,
+        std::print(stderr, "  {:<{}} {:>9} {:>14.3f} {:>9.2f}%{}\n",
+                   name_with_indent(n.name, depth), nameWidth + 2,
+                   n.calls,
                    aliveSec,
-                   proportion * 100.0);
+                   proportion * 100.0,
+                   counterColumns(n));
     };
 
     std::function<void(int, int)> dfs = [&](int parentIdx, int depth) {
@@ -141,17 +221,15 @@ void Profiler::print(bool sortByTime) {
         if (it == children.end()) return;
 
         for (int childIdx : it->second) {
-            auto eIt = byIndex.find(childIdx);
-            if (eIt == byIndex.end()) continue;
-            const Entry &e = entries[eIt->second];
-
-            print_node(e, depth);
+            print_node(nodes[childIdx], depth);
             dfs(childIdx, depth + 1);
         }
     };
 
     auto title = std::format("  {:<{}} {:>9} {:>14} {:>9}",
-                             "name", nameWidth + 3, "calls", "sec", "prop");
+                             heading, nameWidth + 3, "calls", "sec", "prop");
+    if (anyCounted)
+        title += std::format(" {:>9} {:>9} {:>9} {:>9}", "IPC", "L1d MPKI", "LLC MPKI", "br MPKI");
     auto divider = std::string(title.size() + 2, '-');
 
     std::print(stderr, "\n{}\n", divider);
@@ -163,4 +241,3 @@ void Profiler::print(bool sortByTime) {
 
 
 Profiler profiler;
-
@@ -1,73 +1,267 @@
 #pragma once
 
 #include <chrono>
-#include <functional>
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "options.hpp"
+#include "perfcounters.hpp"
 #include "timing.hpp"
 
-struct Sample {
-    int index = 0;
-    int parent = 0;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef __linux__
+#include <time.h>
+#endif
 
-    size_t calls = 0;
+// closes a thread's counters when the thread exits
+struct PerfCountersCloser {
+    PerfCounters *counters = nullptr;
+    ~PerfCountersCloser() {
+        if (counters)
+            counters->close();
+    }
+};
 
-    timePoint lastTick{};
-    high_resolution_clock::duration timeAlive{};
+/*
+ * Hierarchical scope profiler. Each PROFILE_SCOPE call site registers its
+ * name once, in a function local static, and gets a small integer id. Every
+ * thread records into its own tree of nodes, where a node's children are
+ * found by indexing an array with the scope id, so entering a scope costs
+ * an array lookup, a push and one clock read and needs no locks.
+ *
+ * print() merges the threads' trees by call path. Times of scopes that ran
+ * on several threads at once are summed, so they can add up to more than
+ * 100%.
+ *
+ * PROFILE_SCOPE_COUNTERS scopes also read the thread's hardware counters
+ * (see perfcounters.hpp) on entry and exit when profiling with
+ * --profile-counters. That costs a few syscalls, so it is meant for scopes
+ * that run for at least tens of microseconds, like a tile or a render phase.
+ *
+ * PROFILE_SCOPE_DETAIL marks scopes entered per sample or per bounce. Two
+ * clock reads there add 10-20% to a profiled render, so they are compiled
+ * in only with PROFILING_DETAIL (cmake -DENABLE_PROFILING_DETAIL=ON).
+ *
+ * Building with NO_PROFILING (cmake -DENABLE_PROFILING=OFF) compiles every
+ * scope out.
+ */
+class Profiler {
+public:
+    struct Frame {
+        int node;
+        uint64_t start;
+    };
 
-    bool alive = false;
-};
+    struct Node {
+        int scope = -1;
+        int parent = 0;
+        uint64_t calls = 0;
+        uint64_t ticks = 0;
+        bool counted = false;
+        PerfValues counts;
+        std::vector<int> children;  // node index per scope id, 0 if none yet
+    };
 
-class Profiler;
-extern Profiler profiler;
+    struct ThreadSamples {
+        void reset();
 
-void sample_end(Sample* sample);
+        void enter(int scope, uint64_t now) {
+            int parent = stack.back().node;
+            const std::vector<int> &kids = nodes[parent].children;
+            int node = scope < int(kids.size()) ? kids[scope] : 0;
+            if (!node)
+                node = addNode(scope, parent);
+            stack.push_back({node, now});
+        }
 
-inline constexpr auto sampleDeleter = [](Sample* s) noexcept {
-    if (s && s->alive) sample_end(s);
-};
+        void leave(uint64_t now) {
+            Frame f = stack.back();
+            stack.pop_back();
+            Node &n = nodes[f.node];
+            ++n.calls;
+            n.ticks += now - f.start;
+        }
 
-using SampleHandle = std::unique_ptr<Sample, decltype(sampleDeleter)>;
+        int addNode(int scope, int parent);
 
-[[nodiscard]] SampleHandle sample_start(std::string_view sampleName);
+        // hardware counts of the innermost open scope
+        void addCounts(const PerfValues &c) {
+            Node &n = nodes[stack.back().node];
+            n.counted = true;
+            n.counts += c;
+        }
+
+        // this thread's counters, opened on first use and closed when the
+        // thread exits; null if unavailable
+        PerfCounters *counters() {
+            if (!perfTried) {
+                perfTried = true;
+                if (perf.open())
+                    closeAtExit.counters = &perf;
+            }
+            return perf.isOpen() ? &perf : nullptr;
+        }
+
+        int id = 0;  // registration order, the first thread to profile is 0
+        std::vector<Node> nodes;    // nodes[0] is the root
+        std::vector<Frame> stack;
+        PerfCounters perf;
+        bool perfTried = false;
+
+    private:
+        // samples outlive their thread, its counters' descriptors should not
+        static inline thread_local PerfCountersCloser closeAtExit;
+    };
 
-class Profiler {
-public:
     Profiler() {}
 
-    void init() {
-        profiling = true;
-        firstTick = curr_time();
-        currIndex = 1;
-        stack.clear();
-        stack.reserve(20);
-        stack.push_back(0);
-    }
+    // counters enables hardware counters in PROFILE_SCOPE_COUNTERS scopes,
+    // with a warning if the machine does not allow them
+    void init(ProfileClock clock = ProfileClock::Steady, bool counters = false);
 
     void shutdown() { Options->profiling = false; }
-    void print(bool sortByTime = false);
+    // perThread adds one table per thread after the merged one
+    void print(bool sortByTime = false, bool perThread = false);
+
+    // id for a scope name, the same for every call site using that name
+    int registerScope(std::string_view name);
+
+    ThreadSamples &local() {
+        if (!current)
+            registerThread();
+        return *current;
+    }
+
+    uint64_t now() const {
+        switch (clock) {
+#if defined(__x86_64__) || defined(__i386__)
+        case ProfileClock::Tsc:
+            return __rdtsc();
+#endif
+#ifdef __linux__
+        case ProfileClock::Coarse: {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+            return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+#endif
+        default:
+            return std::chrono::duration_cast<nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+    // a node of a printed tree, index 0 is the root
+    struct Entry {
+        std::string_view name;
+        int parent = 0;
+        uint64_t calls = 0;
+        uint64_t ticks = 0;
+        bool counted = false;
+        PerfValues counts;
+    };
+
+    // every thread's tree merged by call path, as print() shows it
+    std::vector<Entry> merged();
 
     bool profiling;
+    bool counting = false;
 
 private:
-    friend SampleHandle sample_start(std::string_view sampleName);
-    friend void sample_end(Sample* sample);
-
-    int currIndex = 1;
+    void registerThread();
+    std::vector<Entry> mergeTrees(const std::vector<const ThreadSamples *> &trees) const;
+    void printTree(const std::vector<Entry> &entries, const std::string &heading, bool sortByTime,
+                   double secondsPerTick) const;
 
-    std::vector<int> stack{0};
+    static inline constinit thread_local ThreadSamples *current = nullptr;
 
+    ProfileClock clock = ProfileClock::Steady;
     timePoint firstTick{};
+    uint64_t firstClockTick = 0;
 
-    using Bucket = std::map<int, Sample>;
-    std::map<std::string, Bucket, std::less<>> samples;
+    // scope names and every thread's samples, guarded by mutex; the samples
+    // themselves are only touched by their own thread until print()
+    std::mutex mutex;
+    std::vector<std::string> scopeNames;
+    std::map<std::string, int, std::less<>> scopeIds;
+    std::vector<std::unique_ptr<ThreadSamples>> threads;
 };
 
-#define PROF_CONCAT(a, b) a##b
-#define PROFILE_SCOPE(name) \
-    auto PROF_CONCAT(_profile_scope_, __COUNTER__) = sample_start(name)
+extern Profiler profiler;
+
+class ProfileScope {
+public:
+    explicit ProfileScope(int scope) {
+        if (!profiler.profiling)
+            return;
+        t = &profiler.local();
+        t->enter(scope, profiler.now());
+    }
+    ~ProfileScope() {
+        if (t)
+            t->leave(profiler.now());
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+    // null unless profiling
+    Profiler::ThreadSamples *samples() const { return t; }
+
+private:
+    Profiler::ThreadSamples *t = nullptr;
+};
+
+// a ProfileScope that also attributes hardware counts to its node
+class ProfileCounterScope {
+public:
+    explicit ProfileCounterScope(int scope) : timed(scope) {
+        if (!profiler.counting || !timed.samples())
+            return;
+        perf = timed.samples()->counters();
+        if (perf)
+            start = perf->read();
+    }
+    ~ProfileCounterScope() {
+        if (perf)
+            timed.samples()->addCounts(perf->read() - start);
+    }
+
+    ProfileCounterScope(const ProfileCounterScope &) = delete;
+    ProfileCounterScope &operator=(const ProfileCounterScope &) = delete;
+
+private:
+    ProfileScope timed;  // entered first and left last, so its time includes reading the counters
+    PerfCounters *perf = nullptr;
+    PerfValues start;
+};
+
+#define PROF_CONCAT_IMPL(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_IMPL(a, b)
+
+#ifdef NO_PROFILING
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+#define PROFILE_SCOPE_COUNTERS(name) static_cast<void>(0)
+#else
+#define PROFILE_SCOPE_IMPL(name, n)                                                   \
+    static const int PROF_CONCAT(_profile_id_, n) = profiler.registerScope(name);    \
+    ProfileScope PROF_CONCAT(_profile_scope_, n)(PROF_CONCAT(_profile_id_, n))
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_IMPL(name, __COUNTER__)
+#define PROFILE_SCOPE_COUNTERS_IMPL(name, n)                                          \
+    static const int PROF_CONCAT(_profile_id_, n) = profiler.registerScope(name);    \
+    ProfileCounterScope PROF_CONCAT(_profile_scope_, n)(PROF_CONCAT(_profile_id_, n))
+#define PROFILE_SCOPE_COUNTERS(name) PROFILE_SCOPE_COUNTERS_IMPL(name, __COUNTER__)
+#endif
+
+#if defined(PROFILING_DETAIL) && !defined(NO_PROFILING)
+#define PROFILE_SCOPE_DETAIL(name) PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE_DETAIL(name) static_cast<void>(0)
+#endif
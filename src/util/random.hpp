@@ -11,6 +11,21 @@ inline uint64_t& state() {
     return s;
 }
 
+// reseed the calling thread, e.g. per pixel so results do not depend on scheduling
+inline void seed(uint64_t s) {
+    state() = s ? s : 0xDEADBEEF;
+}
+
+// MurmurHash3 finalizer, for turning structured seeds into well mixed ones
+inline uint64_t mixBits(uint64_t v) {
+    v ^= (v >> 31);
+    v *= 0x7fb5d329728ea185ULL;
+    v ^= (v >> 27);
+    v *= 0x81dadef4bc2dd44dULL;
+    v ^= (v >> 33);
+    return v;
+}
+
 inline uint64_t xorshift64() {
     uint64_t x = state();
 
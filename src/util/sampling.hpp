@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+
+#include "math.hpp"
+#include "parallel.hpp"
+#include "vecmath.hpp"
+#include "../raytracer.hpp"
+
+constexpr Float OneMinusEpsilon = 0x1.fffffffffffffp-1;
+
+inline Float powerHeuristic(int nf, Float fPdf, int ng, Float gPdf) {
+    Float f = nf * fPdf, g = ng * gPdf;
+    if (std::isinf(sqr(f)))
+        return 1;
+    return sqr(f) / (sqr(f) + sqr(g));
+}
+
+// returns the largest index i in [0, size - 2] such that pred(i) is true
+template <typename Predicate>
+inline std::size_t findInterval(std::size_t size, const Predicate &pred) {
+    std::ptrdiff_t first = 1, sz = std::ptrdiff_t(size) - 2;
+    while (sz > 0) {
+        std::ptrdiff_t half = sz >> 1, middle = first + half;
+        bool predResult = pred(middle);
+        first = predResult ? middle + 1 : first;
+        sz = predResult ? sz - (half + 1) : half;
+    }
+    return std::size_t(clamp(first - 1, 0, std::ptrdiff_t(size) - 2));
+}
+
+// piecewise-constant distribution over [0, 1) with one bucket per entry of func
+class PiecewiseConstant1D {
+public:
+    PiecewiseConstant1D() = default;
+
+    explicit PiecewiseConstant1D(std::span<const Float> f)
+    : func(f.begin(), f.end()), cdf(f.size() + 1) {
+        DCHECK(!func.empty());
+        std::size_t n = func.size();
+
+        for (auto &v : func)
+            v = std::abs(v);
+
+        cdf[0] = 0;
+        for (std::size_t i = 1; i < n + 1; ++i)
+            cdf[i] = cdf[i - 1] + func[i - 1] / n;
+
+        funcInt = cdf[n];
+        if (funcInt == 0)
+            for (std::size_t i = 1; i < n + 1; ++i)
+                cdf[i] = Float(i) / Float(n);
+        else
+            for (std::size_t i = 1; i < n + 1; ++i)
+                cdf[i] /= funcInt;
+    }
+
+    std::size_t size() const { return func.size(); }
+    Float integral() const { return funcInt; }
+
+    Float sample(Float u, Float *pdf = nullptr, int *offset = nullptr) const {
+        int o = int(findInterval(cdf.size(), [&](std::size_t i) { return cdf[i] <= u; }));
+        if (offset)
+            *offset = o;
+
+        Float du = u - cdf[o];
+        if (cdf[o + 1] - cdf[o] > 0)
+            du /= cdf[o + 1] - cdf[o];
+        DCHECK(!isnan(du));
+
+        if (pdf)
+            *pdf = (funcInt > 0) ? func[o] / funcInt : 0;
+
+        return std::min<Float>((o + du) / size(), OneMinusEpsilon);
+    }
+
+    std::vector<Float> func, cdf;
+    Float funcInt = 0;
+};
+
+/*
+ * Piecewise-constant distribution over [0, 1)^2, sampled as a marginal over v
+ * followed by the conditional over u in the chosen row. The conditional rows
+ * are stored back to back in two flat arrays rather than as one heap object
+ * per row, so a sample touches two contiguous rows and nothing else.
+ */
+class PiecewiseConstant2D {
+public:
+    PiecewiseConstant2D() = default;
+
+    PiecewiseConstant2D(std::span<const Float> f, int nu, int nv)
+    : nu(nu), nv(nv), condFunc(std::size_t(nu) * nv), condCdf(std::size_t(nu + 1) * nv),
+      condInt(nv) {
+        CHECK_EQ(f.size(), std::size_t(nu) * nv);
+
+        parallelFor(0, nv, [&](int64_t v) {
+            PiecewiseConstant1D row(f.subspan(std::size_t(v) * nu, nu));
+            std::copy(row.func.begin(), row.func.end(), condFunc.begin() + std::size_t(v) * nu);
+            std::copy(row.cdf.begin(), row.cdf.end(), condCdf.begin() + std::size_t(v) * (nu + 1));
+            condInt[v] = row.integral();
+        }, 16);
+
+        marginal = PiecewiseConstant1D(condInt);
+    }
+
+    Float integral() const { return marginal.integral(); }
+
+    Point2f sample(Point2f u, Float *pdf = nullptr) const {
+        Float pdfs[2];
+        int v;
+        Float d1 = marginal.sample(u[1], &pdfs[1], &v);
+
+        const Float *func = &condFunc[std::size_t(v) * nu];
+        const Float *cdf = &condCdf[std::size_t(v) * (nu + 1)];
+
+        int o = int(findInterval(nu + 1, [&](std::size_t i) { return cdf[i] <= u[0]; }));
+        Float du = u[0] - cdf[o];
+        if (cdf[o + 1] - cdf[o] > 0)
+            du /= cdf[o + 1] - cdf[o];
+
+        pdfs[0] = (condInt[v] > 0) ? func[o] / condInt[v] : 0;
+        Float d0 = std::min<Float>((o + du) / nu, OneMinusEpsilon);
+
+        if (pdf)
+            *pdf = pdfs[0] * pdfs[1];
+        return Point2f(d0, d1);
+    }
+
+    Float pdf(Point2f p) const {
+        int iu = clamp(int(p[0] * nu), 0, nu - 1);
+        int iv = clamp(int(p[1] * nv), 0, nv - 1);
+        if (marginal.integral() == 0)
+            return 0;
+        return condFunc[std::size_t(iv) * nu + iu] / marginal.integral();
+    }
+
+private:
+    int nu = 0, nv = 0;
+    std::vector<Float> condFunc, condCdf, condInt;
+    PiecewiseConstant1D marginal;
+};
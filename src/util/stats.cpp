@@ -0,0 +1,83 @@
+#include "stats.hpp"
+#include "log.hpp"
+#include <cstdio>
+#include <format>
+#include <string>
+
+std::mutex RayStats::mutex;
+std::vector<std::unique_ptr<RayStats>> RayStats::threads;
+
+RayStats &RayStats::operator+=(const RayStats &o) {
+    cameraRays += o.cameraRays;
+    secondaryRays += o.secondaryRays;
+    shadowRays += o.shadowRays;
+    primitiveTests += o.primitiveTests;
+    for (int i = 0; i < depthBuckets; ++i)
+        pathDepth[i] += o.pathDepth[i];
+    for (int i = 0; i < testBuckets; ++i)
+        testsPerRay[i] += o.testsPerRay[i];
+    return *this;
+}
+
+void RayStats::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<RayStats>());
+    current = threads.back().get();
+}
+
+void RayStats::resetAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &t : threads)
+        *t = RayStats();
+}
+
+RayStats RayStats::mergeAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    RayStats sum;
+    for (const auto &t : threads)
+        sum += *t;
+    return sum;
+}
+
+void reportRayStats([[maybe_unused]] const RayStats &s, [[maybe_unused]] double seconds) {
+#ifndef NO_STATS
+    uint64_t rays = s.totalRays();
+    if (rays == 0)
+        return;
+    uint64_t queries = 0;
+    for (uint64_t n : s.testsPerRay)
+        queries += n;
+
+    LOG_VERBOSE("rays              = {:.2f}M ({:.2f}M camera, {:.2f}M secondary, {:.2f}M shadow)",
+                rays / 1e6, s.cameraRays / 1e6, s.secondaryRays / 1e6, s.shadowRays / 1e6);
+    LOG_VERBOSE("ray throughput    = {:.2f} Mrays/s", seconds > 0 ? rays / seconds / 1e6 : 0.0);
+    LOG_VERBOSE("primitive tests   = {:.2f}M ({:.1f} per ray)", s.primitiveTests / 1e6,
+                queries ? double(s.primitiveTests) / queries : 0.0);
+
+    uint64_t paths = 0, hits = 0;
+    for (int d = 0; d < RayStats::depthBuckets; ++d) {
+        paths += s.pathDepth[d];
+        hits += d * s.pathDepth[d];
+    }
+    if (paths == 0)
+        return;
+    LOG_VERBOSE("path depth        = {:.2f} hits on average", double(hits) / paths);
+    // list depths until 99% of the paths are covered, then lump the tail together
+    uint64_t listed = 0;
+    for (int d = 0; d < RayStats::depthBuckets && listed < paths; ++d) {
+        if (listed >= paths * 0.99 || d == RayStats::depthBuckets - 1) {
+            LOG_VERBOSE("  {:>2}+ hits  {:>6.2f}%", d, 100.0 * (paths - listed) / paths);
+            break;
+        }
+        LOG_VERBOSE("  {:>2}  hits  {:>6.2f}%", d, 100.0 * s.pathDepth[d] / paths);
+        listed += s.pathDepth[d];
+    }
+
+    LOG_VERBOSE("tests per query:");
+    for (int b = 0; b < RayStats::testBuckets; ++b)
+        if (s.testsPerRay[b]) {
+            std::string range = b == 0 ? "0" : std::format("{}-{}", uint64_t(1) << (b - 1), (uint64_t(1) << b) - 1);
+            LOG_VERBOSE("  {:>13}  {:>6.2f}%", range, 100.0 * s.testsPerRay[b] / queries);
+        }
+#endif
+}
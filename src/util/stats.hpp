@@ -0,0 +1,71 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Per-thread ray statistics. Each thread counts into its own RayStats,
+ * registered the first time it counts anything, so the counters are plain
+ * increments. render() resets them before tracing and merges them after.
+ *
+ * Building with NO_STATS (cmake -DENABLE_STATS=OFF) compiles every STAT_*
+ * macro to nothing.
+ */
+struct RayStats {
+    static constexpr int depthBuckets = 64;  // the last one also counts deeper paths
+    static constexpr int testBuckets = 33;   // log2 buckets, [2^(i-1), 2^i)
+
+    uint64_t cameraRays = 0;
+    uint64_t secondaryRays = 0;
+    uint64_t shadowRays = 0;
+    uint64_t primitiveTests = 0;
+
+    // surface hits per path, and primitive tests per intersection query
+    uint64_t pathDepth[depthBuckets] = {};
+    uint64_t testsPerRay[testBuckets] = {};
+
+    void addPathDepth(int depth) { ++pathDepth[depth < depthBuckets ? depth : depthBuckets - 1]; }
+    void addTests(uint64_t n) {
+        primitiveTests += n;
+        int b = std::bit_width(n);
+        ++testsPerRay[b < testBuckets ? b : testBuckets - 1];
+    }
+
+    RayStats &operator+=(const RayStats &o);
+
+    uint64_t totalRays() const { return cameraRays + secondaryRays + shadowRays; }
+
+    static RayStats &local() {
+        if (!current)
+            registerThread();
+        return *current;
+    }
+
+    // zeroes every thread's counters; call while no thread is counting
+    static void resetAll();
+    // sum over threads
+    static RayStats mergeAll();
+
+private:
+    static void registerThread();
+
+    static inline constinit thread_local RayStats *current = nullptr;
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<RayStats>> threads;
+};
+
+// logs ray counts, Mrays/s over seconds and the histograms
+void reportRayStats(const RayStats &stats, double seconds);
+
+#ifdef NO_STATS
+#define STAT_ADD(counter, n) static_cast<void>(0)
+#define STAT_PATH_DEPTH(depth) static_cast<void>(0)
+#define STAT_TESTS(n) static_cast<void>(0)
+#else
+#define STAT_ADD(counter, n) static_cast<void>(RayStats::local().counter += (n))
+#define STAT_PATH_DEPTH(depth) RayStats::local().addPathDepth(depth)
+#define STAT_TESTS(n) RayStats::local().addTests(n)
+#endif
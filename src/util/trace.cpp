@@ -0,0 +1,100 @@
+#include "trace.hpp"
+#include "check.h"
+#include "error.hpp"
+#include "json.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <format>
+#include <print>
+
+Tracer tracer;
+
+void Tracer::init(std::size_t eventsPerThread) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CHECK(rings.empty());
+        capacity = std::bit_ceil(std::max<std::size_t>(eventsPerThread, 16));
+        start = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+    // the calling thread gets the first track
+    local();
+}
+
+void Tracer::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto r = std::make_unique<Ring>();
+    r->events = std::make_unique<TraceEvent[]>(capacity);
+    r->mask = capacity - 1;
+    r->tid = int(rings.size());
+    r->name = r->tid == 0 ? "main" : std::format("thread {}", r->tid);
+    current = r.get();
+    rings.push_back(std::move(r));
+}
+
+void Tracer::nameThread(std::string name) {
+    if (!enabled)
+        return;
+    Ring &r = local();
+    std::lock_guard<std::mutex> lock(mutex);
+    r.name = std::move(name);
+}
+
+bool Tracer::write(const std::string &filename) {
+    std::FILE *f = std::fopen(filename.c_str(), "w");
+    if (!f) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t nEvents = 0, dropped = 0;
+    bool first = true;
+    auto separator = [&]() {
+        std::fputs(first ? "\n" : ",\n", f);
+        first = false;
+    };
+
+    std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+    for (const auto &r : rings) {
+        separator();
+        std::print(f, "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":{}}}}}",
+                   r->tid, jsonQuote(r->name));
+        separator();
+        std::print(f, "{{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+                   "\"args\":{{\"sort_index\":{}}}}}", r->tid, r->tid);
+
+        uint64_t head = r->head.load(std::memory_order_acquire);
+        uint64_t begin = head > capacity ? head - capacity : 0;
+        dropped += begin;
+        for (uint64_t i = begin; i < head; ++i) {
+            const TraceEvent &e = r->events[i & r->mask];
+            separator();
+            // complete events, timestamps in microseconds
+            std::print(f, "{{\"name\":{},\"cat\":{},\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                       "\"ts\":{:.3f},\"dur\":{:.3f}", jsonQuote(e.name), jsonQuote(e.category), r->tid,
+                       e.startNs / 1e3, (e.endNs - e.startNs) / 1e3);
+            if (e.nArgs > 0) {
+                std::fputs(",\"args\":{", f);
+                for (int a = 0; a < e.nArgs; ++a)
+                    std::print(f, "{}{}:{}", a ? "," : "", jsonQuote(e.argNames[a]), e.argValues[a]);
+                std::fputc('}', f);
+            }
+            std::fputc('}', f);
+            ++nEvents;
+        }
+    }
+    std::fputs("\n]}\n", f);
+
+    if (std::fclose(f) != 0) {
+        error("{}: {}", filename, errorString());
+        return false;
+    }
+    if (dropped > 0)
+        warning("{}: {} early events were overwritten, the trace starts late on some threads", filename,
+                dropped);
+    LOG_VERBOSE("Wrote {} trace events from {} threads to {}", nEvents, rings.size(), filename);
+    return true;
+}
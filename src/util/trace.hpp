@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * Timeline of coarse events (tiles, passes, scene loading, output) written
+ * as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev load.
+ *
+ * Every thread appends to its own fixed-size ring buffer, publishing each
+ * event with a release store of the head, so recording takes no locks.
+ * When a ring is full the oldest events are overwritten; write() reports
+ * how many were lost. Names and argument keys are stored by pointer and
+ * must be string literals.
+ */
+struct TraceEvent {
+    static constexpr int maxArgs = 4;
+
+    const char *name;
+    const char *category;
+    uint64_t startNs, endNs;
+    int nArgs = 0;
+    const char *argNames[maxArgs];
+    int64_t argValues[maxArgs];
+};
+
+class Tracer {
+public:
+    void init(std::size_t eventsPerThread = 1 << 14);
+
+    // nanoseconds since init()
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+    void record(const TraceEvent &e) {
+        Ring &r = local();
+        uint64_t head = r.head.load(std::memory_order_relaxed);
+        r.events[head & r.mask] = e;
+        r.head.store(head + 1, std::memory_order_release);
+    }
+
+    // label for the calling thread's track; a no-op unless tracing
+    void nameThread(std::string name);
+
+    // events recorded concurrently with write() may be missed
+    bool write(const std::string &filename);
+
+    bool enabled = false;
+
+private:
+    struct Ring {
+        std::unique_ptr<TraceEvent[]> events;
+        uint64_t mask = 0;
+        std::atomic<uint64_t> head{0};
+        int tid = 0;
+        std::string name;
+    };
+
+    Ring &local() {
+        if (!current)
+            registerThread();
+        return *current;
+    }
+    void registerThread();
+
+    static inline constinit thread_local Ring *current = nullptr;
+
+    std::chrono::steady_clock::time_point start;
+    std::size_t capacity = 0;
+
+    std::mutex mutex;  // guards rings, not their contents
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+extern Tracer tracer;
+
+// records [construction, destruction) as one event when tracing is on
+class TraceScope {
+public:
+    explicit TraceScope(const char *name, const char *category = "render") {
+        if (!tracer.enabled)
+            return;
+        active = true;
+        e.name = name;
+        e.category = category;
+        e.startNs = tracer.now();
+    }
+    ~TraceScope() {
+        if (!active)
+            return;
+        e.endNs = tracer.now();
+        tracer.record(e);
+    }
+
+    TraceScope &arg(const char *name, int64_t value) {
+        if (active && e.nArgs < TraceEvent::maxArgs) {
+            e.argNames[e.nArgs] = name;
+            e.argValues[e.nArgs++] = value;
+        }
+        return *this;
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    bool active = false;
+    TraceEvent e;
+};
@@ -753,6 +753,13 @@ public:
         return (i == 0) ? pMin : pMax;
     }
 
+    Vector2<T> diagonal() const { return pMax - pMin; }
+
+    T area() const {
+        Vector2<T> d = diagonal();
+        return d.x * d.y;
+    }
+
     std::string toString() const { 
         return std::format("[ {} - {} ]", pMin.toString(), pMax.toString());
     }
@@ -878,6 +885,11 @@ Bounds3<T> combine(const Bounds3<T> &b1, const Bounds3<T> &b2) {
     return {min(b1.pMin, b2.pMin), max(b1.pMax, b2.pMax)};
 }
 
+template <typename T>
+Bounds2<T> intersect(const Bounds2<T> &b1, const Bounds2<T> &b2) {
+    return {max(b1.pMin, b2.pMin), min(b1.pMax, b2.pMax)};
+}
+
 template <typename T>
 Bounds3<T> intersect(const Bounds3<T> &b1, const Bounds3<T> &b2) {
     return {max(b1.pMin, b2.pMin), min(b1.pMax, b2.pMax)};
@@ -0,0 +1,265 @@
+#include "binscene.hpp"
+#include "../material.h"
+#include "../util/error.hpp"
+#include "../util/log.hpp"
+#include "../util/memory.hpp"
+#include "../util/profiler.hpp"
+#include "../util/random.hpp"
+#include "../util/timing.hpp"
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char magic[4] = {'R', 'T', 'S', 'B'};
+constexpr uint32_t version = 1;
+
+struct CameraRecord {
+    int32_t width, height, spp, maxDepth;
+    double aspect, vfov;
+    double lookfrom[3], lookat[3], vup[3];
+    double defocusAngle, focusDist;
+};
+
+struct MaterialRecord {
+    uint32_t type, pad;
+    double albedo[3];
+    double fuzz, ior;
+};
+
+struct Section {
+    uint64_t offset, count;
+};
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t checksum;      // of the whole file with this field zeroed
+    uint32_t bodyBytes;     // sizeof(Body), guards against layout changes
+    uint32_t endianTag;
+    CameraRecord camera;
+    Section bodies, materialIds, materials, envMap;
+    double envMapScale;
+    uint64_t pad[4];
+};
+static_assert(sizeof(Header) % 64 == 0);
+
+constexpr uint32_t endianTag = 0x01020304;
+constexpr uint64_t alignment = 64;
+
+uint64_t alignUp(uint64_t n) {
+    return (n + alignment - 1) & ~(alignment - 1);
+}
+
+// four independent multiply-rotate lanes, so hashing runs at memory speed;
+// n must be a multiple of 32
+uint64_t checksum(const std::byte *p, std::size_t n, uint64_t seed) {
+    constexpr uint64_t k = 0x9e3779b97f4a7c15ULL;
+    uint64_t h[4] = {seed, seed ^ 1, seed ^ 2, seed ^ 3};
+    for (std::size_t i = 0; i < n; i += 32) {
+        for (int lane = 0; lane < 4; ++lane) {
+            uint64_t w;
+            std::memcpy(&w, p + i + 8 * lane, 8);
+            h[lane] = std::rotl((h[lane] ^ w) * k, 31);
+        }
+    }
+    return Rand::mixBits(h[0] ^ std::rotl(h[1], 16) ^ std::rotl(h[2], 32) ^ std::rotl(h[3], 48) ^ n);
+}
+
+uint64_t fileChecksum(const std::byte *file, std::size_t size) {
+    Header h;
+    std::memcpy(&h, file, sizeof(Header));
+    h.checksum = 0;
+    uint64_t seed = checksum(reinterpret_cast<const std::byte *>(&h), sizeof(Header), 0);
+    return checksum(file + sizeof(Header), size - sizeof(Header), seed);
+}
+
+CameraRecord toRecord(const camera &cam) {
+    return {cam.image_width, cam.image_height, cam.samples_per_pixel, cam.max_depth,
+            cam.aspect_ratio, cam.vfov,
+            {cam.lookfrom.x, cam.lookfrom.y, cam.lookfrom.z},
+            {cam.lookat.x, cam.lookat.y, cam.lookat.z},
+            {cam.vup.x, cam.vup.y, cam.vup.z},
+            cam.defocus_angle, cam.focus_dist};
+}
+
+camera fromRecord(const CameraRecord &r) {
+    camera cam;
+    cam.image_width = r.width;
+    cam.image_height = r.height;
+    cam.samples_per_pixel = r.spp;
+    cam.max_depth = r.maxDepth;
+    cam.aspect_ratio = r.aspect;
+    cam.vfov = r.vfov;
+    cam.lookfrom = Point3f(r.lookfrom[0], r.lookfrom[1], r.lookfrom[2]);
+    cam.lookat = Point3f(r.lookat[0], r.lookat[1], r.lookat[2]);
+    cam.vup = Vector3f(r.vup[0], r.vup[1], r.vup[2]);
+    cam.defocus_angle = r.defocusAngle;
+    cam.focus_dist = r.focusDist;
+    return cam;
+}
+
+} // namespace
+
+void writeBinaryScene(const SceneDescription &scene, const std::string &filename) {
+    PROFILE_SCOPE("writeBinaryScene");
+    const Spheres &world = scene.world;
+    CHECK_EQ(world.centers.size(), world.materialIds.size());
+
+    std::vector<MaterialRecord> materials;
+    for (const auto &m : world.materials) {
+        std::optional<MaterialDesc> desc = m->describe();
+        if (!desc)
+            errorFatal("{}: scene uses a material that cannot be stored in a binary scene", filename);
+        materials.push_back({uint32_t(desc->type), 0,
+                             {desc->albedo.x, desc->albedo.y, desc->albedo.z}, desc->fuzz, desc->ior});
+    }
+
+    Header h{};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.bodyBytes = sizeof(Body);
+    h.endianTag = endianTag;
+    h.camera = toRecord(scene.cam);
+    h.envMapScale = scene.envMapScale;
+
+    uint64_t offset = sizeof(Header);
+    auto place = [&](Section &s, uint64_t count, uint64_t elementBytes) {
+        s = {offset, count};
+        offset = alignUp(offset + count * elementBytes);
+    };
+    place(h.bodies, world.centers.size(), sizeof(Body));
+    place(h.materialIds, world.materialIds.size(), sizeof(uint32_t));
+    place(h.materials, materials.size(), sizeof(MaterialRecord));
+    place(h.envMap, scene.envMap.size(), 1);
+    h.fileSize = offset;
+
+    // zero filled, so padding is deterministic and part of the checksum
+    std::vector<std::byte> file(h.fileSize);
+    auto copy = [&](const Section &s, const void *src, uint64_t elementBytes) {
+        if (s.count)
+            std::memcpy(&file[s.offset], src, s.count * elementBytes);
+    };
+    copy(h.bodies, world.centers.data(), sizeof(Body));
+    copy(h.materialIds, world.materialIds.data(), sizeof(uint32_t));
+    copy(h.materials, materials.data(), sizeof(MaterialRecord));
+    copy(h.envMap, scene.envMap.data(), 1);
+
+    std::memcpy(file.data(), &h, sizeof(Header));
+    h.checksum = fileChecksum(file.data(), file.size());
+    std::memcpy(file.data(), &h, sizeof(Header));
+
+    std::FILE *f = std::fopen(filename.c_str(), "wb");
+    if (!f)
+        errorFatal("{}: {}", filename, errorString());
+    bool ok = std::fwrite(file.data(), 1, file.size(), f) == file.size();
+    ok = std::fclose(f) == 0 && ok;
+    if (!ok)
+        errorFatal("{}: write failed: {}", filename, errorString());
+
+    LOG_VERBOSE("Wrote binary scene {} ({} spheres, {:.2f} MiB)", filename, world.centers.size(),
+                file.size() / double(1 << 20));
+}
+
+bool isBinaryScene(const std::string &filename) {
+    char buf[sizeof(magic)];
+    std::FILE *f = std::fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    bool match = std::fread(buf, 1, sizeof(buf), f) == sizeof(buf) && std::memcmp(buf, magic, sizeof(magic)) == 0;
+    std::fclose(f);
+    return match;
+}
+
+SceneDescription loadBinaryScene(const std::string &filename) {
+    PROFILE_SCOPE_COUNTERS("loadBinaryScene");
+    auto t0 = curr_time();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        errorFatal("{}: {}", filename, errorString());
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        errorFatal("{}: {}", filename, errorString());
+    }
+    std::size_t size = st.st_size;
+    if (size < sizeof(Header)) {
+        close(fd);
+        errorFatal("{}: truncated binary scene", filename);
+    }
+
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    // the checksum reads every page anyway, fault them in one go
+    flags |= MAP_POPULATE;
+#endif
+    void *addr = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        errorFatal("{}: mmap failed: {}", filename, errorString());
+    std::shared_ptr<const void> mapping(addr, [size](const void *p) { munmap(const_cast<void *>(p), size); });
+    const std::byte *file = static_cast<const std::byte *>(addr);
+
+    Header h;
+    std::memcpy(&h, file, sizeof(Header));
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0)
+        errorFatal("{}: not a binary scene", filename);
+    if (h.version != version)
+        errorFatal("{}: binary scene version {}, expected {}", filename, h.version, version);
+    if (h.endianTag != endianTag || h.bodyBytes != sizeof(Body))
+        errorFatal("{}: binary scene was written on an incompatible build", filename);
+    if (h.fileSize != size || size % alignment != 0)
+        errorFatal("{}: binary scene is {} bytes, header says {}", filename, size, h.fileSize);
+    if (fileChecksum(file, size) != h.checksum)
+        errorFatal("{}: binary scene checksum mismatch, the file is corrupted", filename);
+
+    auto section = [&](const Section &s, uint64_t elementBytes, const char *name) {
+        if (s.offset % alignment != 0 || s.offset < sizeof(Header) || s.offset > size ||
+            s.count > (size - s.offset) / elementBytes)
+            errorFatal("{}: binary scene {} section is out of bounds", filename, name);
+        return file + s.offset;
+    };
+    auto *bodies = reinterpret_cast<const Body *>(section(h.bodies, sizeof(Body), "sphere"));
+    auto *ids = reinterpret_cast<const uint32_t *>(section(h.materialIds, sizeof(uint32_t), "material id"));
+    auto *mats = reinterpret_cast<const MaterialRecord *>(section(h.materials, sizeof(MaterialRecord), "material"));
+    auto *env = reinterpret_cast<const char *>(section(h.envMap, 1, "environment map"));
+    if (h.bodies.count != h.materialIds.count)
+        errorFatal("{}: binary scene has {} spheres but {} material ids", filename, h.bodies.count,
+                   h.materialIds.count);
+
+    SceneDescription scene;
+    scene.cam = fromRecord(h.camera);
+    scene.envMap.assign(env, h.envMap.count);
+    scene.envMapScale = h.envMapScale;
+
+    for (uint64_t i = 0; i < h.materials.count; ++i) {
+        const MaterialRecord &r = mats[i];
+        if (r.type > uint32_t(MaterialDesc::Type::Dielectric))
+            errorFatal("{}: unknown material type {}", filename, r.type);
+        scene.world.materials.push_back(makeMaterial({MaterialDesc::Type(r.type),
+                                                      color(r.albedo[0], r.albedo[1], r.albedo[2]),
+                                                      r.fuzz, r.ior}));
+    }
+    // the checksum only catches corruption, ids index the material table directly
+    for (uint64_t i = 0; i < h.materialIds.count; ++i)
+        if (ids[i] >= h.materials.count)
+            errorFatal("{}: sphere {} uses material {} of {}", filename, i, ids[i], h.materials.count);
+
+    scene.world.centers = MappedArray<Body>(bodies, h.bodies.count, mapping);
+    scene.world.materialIds = MappedArray<uint32_t>(ids, h.materialIds.count, mapping);
+
+    LOG_VERBOSE("Mapped {} ({} spheres) in {:.2f}ms", filename, h.bodies.count,
+                diff_time<microseconds>(t0, curr_time()).count() / 1e3);
+    return scene;
+}
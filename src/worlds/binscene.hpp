@@ -0,0 +1,24 @@
+#pragma once
+
+#include "scenefile.hpp"
+#include <string>
+
+/*
+ * Binary scene container for scenes that are rendered repeatedly. A header
+ * with the camera settings and section offsets is followed by 64-byte
+ * aligned arrays of Body, per sphere material ids, material parameters and
+ * the environment map path. A checksum covers everything.
+ *
+ * Loading maps the file and points the sphere arrays straight into the
+ * mapping, so it costs about as much as reading the pages. The layout is
+ * native endian and tied to sizeof(Body); the header records both.
+ */
+
+// errorFatal()s if a material cannot be described or the file cannot be written
+void writeBinaryScene(const SceneDescription &scene, const std::string &filename);
+
+// true if the file starts with the binary scene magic
+bool isBinaryScene(const std::string &filename);
+
+// errorFatal()s on a truncated, corrupted or incompatible file
+SceneDescription loadBinaryScene(const std::string &filename);
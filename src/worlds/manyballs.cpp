@@ -5,54 +5,52 @@
 #include "../util/profiler.hpp"
 #include "../util/random.hpp"
 #include "../raytracer.hpp"
-#include "../scene.hpp"
+#include "scenefile.hpp"
 
-Scene manyBalls() {
-    PROFILE_SCOPE("many_balls init");
+namespace {
 
-    Spheres world;
-    camera cam;
+/*
+ * The cover scene of "Ray Tracing in One Weekend": small balls on a
+ * (2 * extent)^2 grid around three large ones. Materials are picked with
+ * the given chances of diffuse and metal, the rest are glass; glass balls
+ * are hollow (a second, inward facing surface) with chance hollow.
+ */
+SceneDescription ballGrid(int extent, Float diffuse, Float metallic, Float hollow) {
+    SceneDescription scene;
+    Spheres &world = scene.world;
+    camera &cam = scene.cam;
 
-    world.materials.push_back(std::make_shared<lambertian>(color(0.5, 0.5, 0.5)));
-    world.centers.push_back({Point3f(0,-1000,0), 1000});
+    world.add({Point3f(0,-1000,0), 1000}, std::make_shared<lambertian>(color(0.5, 0.5, 0.5)));
 
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
+    auto glass = std::make_shared<dielectric>(1.5);
+    for (int a = -extent; a < extent; a++) {
+        for (int b = -extent; b < extent; b++) {
             auto choose_mat = Rand::random<Float>();
             Point3f center(a + 0.9*Rand::random<Float>(), 0.2, b + 0.9*Rand::random<Float>());
 
             if (length(center - Point3f(4, 0.2, 0)) > 0.9) {
-                shared_ptr<material> sphere_material;
-
-                if (choose_mat < 0.8) {
-                    // diffuse
+                if (choose_mat < diffuse) {
                     auto albedo = color::random() * color::random();
-                    world.materials.push_back(std::make_shared<lambertian>(albedo));
-                    world.centers.push_back({center, 0.2});
-                } else if (choose_mat < 0.95) {
-                    // metal
+                    world.add({center, 0.2}, std::make_shared<lambertian>(albedo));
+                } else if (choose_mat < diffuse + metallic) {
                     auto albedo = color::random(0.5, 1);
                     auto fuzz = Rand::random<Float>(0, 0.5);
-                    world.materials.push_back(std::make_shared<metal>(albedo, fuzz));
-                    world.centers.push_back({center, 0.2});
+                    world.add({center, 0.2}, std::make_shared<metal>(albedo, fuzz));
                 } else {
-                    // glass
-                    sphere_material = std::make_shared<dielectric>(1.5);
-                    world.materials.push_back(std::make_shared<dielectric>(1.5));
-                    world.centers.push_back({center, 0.2});
+                    world.add({center, 0.2}, glass);
+                    // a negative radius flips the normals, making a bubble
+                    if (hollow > 0 && Rand::random<Float>() < hollow)
+                        world.add({center, -0.17}, glass);
                 }
             }
         }
     }
 
-    world.materials.push_back(std::make_shared<dielectric>(1.5));
-    world.centers.push_back({Point3f(0, 1, 0), 1.0});
+    world.add({Point3f(0, 1, 0), 1.0}, glass);
 
-    world.materials.push_back(std::make_shared<lambertian>(color(0.4, 0.2, 0.1)));
-    world.centers.push_back({Point3f(-4, 1, 0), 1.0});
+    world.add({Point3f(-4, 1, 0), 1.0}, std::make_shared<lambertian>(color(0.4, 0.2, 0.1)));
 
-    world.materials.push_back(std::make_shared<metal>(color(0.7, 0.6, 0.5), 0.0));
-    world.centers.push_back({Point3f(4, 1, 0), 1.0});
+    world.add({Point3f(4, 1, 0), 1.0}, std::make_shared<metal>(color(0.7, 0.6, 0.5), 0.0));
 
     cam.aspect_ratio      = 16.0 / 9.0;
     cam.image_width       = 800;
@@ -67,5 +65,30 @@ Scene manyBalls() {
     cam.defocus_angle = 0.6;
     cam.focus_dist    = 10.0;
 
-    return {world, cam};
+    return scene;
+}
+
+} // namespace
+
+SceneDescription manyBalls() {
+    PROFILE_SCOPE("many_balls init");
+    return ballGrid(11, 0.8, 0.15, 0);
+}
+
+// 4x the balls of manyballs, the same view
+SceneDescription manyBallsLarge() {
+    PROFILE_SCOPE("many_balls init");
+    return ballGrid(22, 0.8, 0.15, 0);
+}
+
+// 16x the balls of manyballs, the same view
+SceneDescription manyBallsHuge() {
+    PROFILE_SCOPE("many_balls init");
+    return ballGrid(44, 0.8, 0.15, 0);
+}
+
+// manyballs with 70% glass, half of it hollow, so paths refract many times
+SceneDescription glassBalls() {
+    PROFILE_SCOPE("many_balls init");
+    return ballGrid(11, 0.15, 0.15, 0.5);
 }
@@ -0,0 +1,341 @@
+#include "scenefile.hpp"
+#include "../material.h"
+#include "../util/error.hpp"
+#include "../util/file.hpp"
+#include "../util/log.hpp"
+#include "../util/profiler.hpp"
+#include "../util/timing.hpp"
+#include "../util/transform.hpp"
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+template <typename T>
+using NameMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+struct Geometry {
+    std::vector<Body> bodies;
+    std::vector<uint32_t> materials;
+};
+
+class SceneParser {
+public:
+    SceneParser(std::string_view text, std::string_view filename)
+    : pos(text.data()), end(text.data() + text.size()), lineStart(pos), filename(filename) {}
+
+    SceneDescription parse();
+
+private:
+    // tokens are views into the text, nothing is copied until a name is stored
+    void skipSpace() {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+            ++pos;
+        if (pos < end && *pos == '#')
+            while (pos < end && *pos != '\n')
+                ++pos;
+    }
+
+    bool atEndOfLine() {
+        skipSpace();
+        return pos == end || *pos == '\n';
+    }
+
+    std::string_view token() {
+        if (atEndOfLine())
+            fail("unexpected end of line");
+        const char *start = pos;
+        if (*pos == '"') {
+            while (++pos < end && *pos != '"' && *pos != '\n')
+                ;
+            if (pos == end || *pos != '"')
+                fail("unterminated string");
+            return {start + 1, std::size_t(pos++ - start - 1)};
+        }
+        while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n' && *pos != '#')
+            ++pos;
+        return {start, std::size_t(pos - start)};
+    }
+
+    Float number() {
+        const char *start = (skipSpace(), pos);
+        std::string_view tok = token();
+        Float v;
+        auto [p, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), v);
+        if (ec != std::errc() || p != tok.data() + tok.size() || !std::isfinite(v)) {
+            pos = start;
+            fail("expected a number, got \"{}\"", tok);
+        }
+        return v;
+    }
+
+    int integer() {
+        Float v = number();
+        if (v != std::floor(v) || v < 1 || v > 1 << 20)
+            fail("expected a positive integer, got {}", v);
+        return int(v);
+    }
+
+    Point3f point() {
+        Float x = number(), y = number();
+        return Point3f(x, y, number());
+    }
+
+    Vector3f vector() { return Vector3f(point()); }
+
+    color rgb() {
+        Float r = number(), g = number();
+        return color(r, g, number());
+    }
+
+    void endLine() {
+        if (!atEndOfLine())
+            fail("unexpected \"{}\"", token());
+        if (pos < end) {
+            ++pos;
+            ++line;
+            lineStart = pos;
+        }
+    }
+
+    template <typename... Args>
+    [[noreturn]] void fail(std::format_string<Args...> fmt, Args &&...args) {
+        FileLoc loc(filename, line, int(pos - lineStart) + 1);
+        errorFatal(&loc, fmt, std::forward<Args>(args)...);
+    }
+
+    void parseImage(camera &cam);
+    void parseCamera(camera &cam);
+    void parseMaterial();
+    void parseSphere(Geometry &g);
+    void parseInstance(Geometry &g);
+    void parseLight(SceneDescription &scene);
+
+    const char *pos, *end, *lineStart;
+    int line = 1;
+    std::string_view filename;
+
+    std::vector<std::shared_ptr<material>> materials;
+    NameMap<uint32_t> materialIndex;
+    NameMap<Geometry> objects;
+};
+
+SceneDescription SceneParser::parse() {
+    SceneDescription scene;
+    Geometry world;
+    Geometry *current = &world;
+    std::string objectName;
+    bool haveCamera = false;
+
+    while (pos < end) {
+        if (atEndOfLine()) {
+            endLine();
+            continue;
+        }
+
+        std::string_view directive = token();
+        if (directive == "image") {
+            parseImage(scene.cam);
+        } else if (directive == "camera") {
+            parseCamera(scene.cam);
+            haveCamera = true;
+        } else if (directive == "material") {
+            parseMaterial();
+        } else if (directive == "sphere") {
+            parseSphere(*current);
+        } else if (directive == "instance") {
+            parseInstance(*current);
+        } else if (directive == "object") {
+            if (current != &world)
+                fail("object \"{}\" is missing its \"end\"", objectName);
+            objectName = token();
+            if (objects.contains(objectName))
+                fail("object \"{}\" is already defined", objectName);
+            current = &objects[objectName];
+        } else if (directive == "end") {
+            if (current == &world)
+                fail("\"end\" without \"object\"");
+            current = &world;
+        } else if (directive == "light") {
+            parseLight(scene);
+        } else {
+            pos -= directive.size();
+            fail("unknown directive \"{}\"", directive);
+        }
+        endLine();
+    }
+
+    if (current != &world)
+        fail("object \"{}\" is missing its \"end\"", objectName);
+    if (world.bodies.empty())
+        fail("scene has no spheres");
+    if (!haveCamera)
+        warning("{}: no camera given, using the defaults", filename);
+
+    scene.world.centers = std::move(world.bodies);
+    scene.world.materialIds = std::move(world.materials);
+    scene.world.materials = std::move(materials);
+    return scene;
+}
+
+void SceneParser::parseImage(camera &cam) {
+    while (!atEndOfLine()) {
+        std::string_view key = token();
+        if (key == "width")
+            cam.image_width = integer();
+        else if (key == "height")
+            cam.image_height = integer();
+        else if (key == "aspect")
+            cam.aspect_ratio = number();
+        else if (key == "spp")
+            cam.samples_per_pixel = integer();
+        else if (key == "depth")
+            cam.max_depth = integer();
+        else
+            fail("unknown image setting \"{}\"", key);
+    }
+    if (cam.aspect_ratio <= 0)
+        fail("aspect must be positive");
+}
+
+void SceneParser::parseCamera(camera &cam) {
+    while (!atEndOfLine()) {
+        std::string_view key = token();
+        if (key == "lookfrom")
+            cam.lookfrom = point();
+        else if (key == "lookat")
+            cam.lookat = point();
+        else if (key == "up")
+            cam.vup = vector();
+        else if (key == "fov")
+            cam.vfov = number();
+        else if (key == "defocus")
+            cam.defocus_angle = number();
+        else if (key == "focus")
+            cam.focus_dist = number();
+        else
+            fail("unknown camera setting \"{}\"", key);
+    }
+    if (cam.lookfrom == cam.lookat)
+        fail("camera lookfrom and lookat are the same point");
+}
+
+void SceneParser::parseMaterial() {
+    std::string_view name = token();
+    if (materialIndex.contains(name))
+        fail("material \"{}\" is already defined", name);
+
+    std::string_view type = token();
+    std::shared_ptr<material> m;
+    if (type == "lambertian") {
+        m = std::make_shared<lambertian>(rgb());
+    } else if (type == "metal") {
+        color albedo = rgb();
+        m = std::make_shared<metal>(albedo, number());
+    } else if (type == "dielectric") {
+        m = std::make_shared<dielectric>(number());
+    } else {
+        fail("unknown material type \"{}\"", type);
+    }
+
+    materialIndex.emplace(name, uint32_t(materials.size()));
+    materials.push_back(std::move(m));
+}
+
+void SceneParser::parseSphere(Geometry &g) {
+    std::string_view name = token();
+    auto m = materialIndex.find(name);
+    if (m == materialIndex.end())
+        fail("undefined material \"{}\"", name);
+
+    Point3f center = point();
+    Float radius = number();
+    if (radius <= 0)
+        fail("sphere radius must be positive");
+
+    g.bodies.push_back({center, radius});
+    g.materials.push_back(m->second);
+}
+
+void SceneParser::parseInstance(Geometry &g) {
+    std::string_view name = token();
+    auto obj = objects.find(name);
+    if (obj == objects.end())
+        fail("undefined object \"{}\"", name);
+    if (&obj->second == &g)
+        fail("object \"{}\" instances itself", name);
+
+    Transform t;
+    while (!atEndOfLine()) {
+        std::string_view op = token();
+        if (op == "translate") {
+            t = t * translate(vector());
+        } else if (op == "rotate") {
+            Float theta = number();
+            Vector3f axis = vector();
+            if (lengthSquared(axis) == 0)
+                fail("rotation axis is zero");
+            t = t * rotate(theta, axis);
+        } else if (op == "scale") {
+            Float s = number();
+            if (s <= 0)
+                fail("scale must be positive");
+            t = t * scale(s, s, s);
+        } else {
+            fail("unknown transform \"{}\"", op);
+        }
+    }
+
+    // the transform is built from rotations and uniform scales only
+    Float radiusScale = length(t(Vector3f(1, 0, 0)));
+    const Geometry &src = obj->second;
+    g.bodies.reserve(g.bodies.size() + src.bodies.size());
+    for (const Body &b : src.bodies)
+        g.bodies.push_back({t(b.center), b.radius * radiusScale});
+    g.materials.insert(g.materials.end(), src.materials.begin(), src.materials.end());
+}
+
+void SceneParser::parseLight(SceneDescription &scene) {
+    std::string_view type = token();
+    if (type != "environment")
+        fail("unknown light type \"{}\", expected environment", type);
+
+    std::filesystem::path file(token());
+    if (file.is_relative())
+        file = std::filesystem::path(filename).parent_path() / file;
+    scene.envMap = file.string();
+
+    while (!atEndOfLine()) {
+        std::string_view key = token();
+        if (key != "scale")
+            fail("unknown light setting \"{}\"", key);
+        scene.envMapScale = number();
+    }
+}
+
+} // namespace
+
+SceneDescription parseScene(std::string_view text, std::string_view filename) {
+    PROFILE_SCOPE_COUNTERS("parseScene");
+    return SceneParser(text, filename).parse();
+}
+
+SceneDescription loadSceneFile(const std::string &filename) {
+    PROFILE_SCOPE("loadSceneFile");
+    auto t0 = curr_time();
+
+    SceneDescription scene = parseScene(readFile(filename), filename);
+    LOG_VERBOSE("Parsed {} ({} spheres) in {}ms", filename, scene.world.centers.size(),
+                diff_time<milliseconds>(t0, curr_time()).count());
+    return scene;
+}
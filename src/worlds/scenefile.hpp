@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../camera.h"
+#include "../sphere.h"
+#include <string>
+#include <string_view>
+
+/*
+ * Text scene description, one directive per line, '#' starts a comment:
+ *
+ *   image width 800 aspect 1.7778 spp 10 depth 50     (or height instead of aspect)
+ *   camera lookfrom 13 2 3 lookat 0 0 0 up 0 1 0 fov 20 defocus 0.6 focus 10
+ *   material NAME lambertian R G B
+ *   material NAME metal R G B FUZZ
+ *   material NAME dielectric IOR
+ *   sphere MATERIAL X Y Z RADIUS
+ *   object NAME                                        (spheres and instances until "end")
+ *   end
+ *   instance NAME translate X Y Z rotate DEG AX AY AZ scale S ...
+ *   light environment "FILE" scale S
+ *
+ * image and camera keys are all optional. Instance transforms apply right
+ * to left, as when multiplied out, and are flattened into world spheres at
+ * parse time, so they must keep spheres round (uniform scale only).
+ */
+struct SceneDescription {
+    Spheres world;
+    camera cam;
+    std::string envMap;      // resolved against the scene file's directory
+    Float envMapScale = 1;
+};
+
+// errorFatal()s with the file and line on any syntax or reference error
+SceneDescription parseScene(std::string_view text, std::string_view filename);
+SceneDescription loadSceneFile(const std::string &filename);
@@ -0,0 +1,53 @@
+#include "worlds.hpp"
+#include "binscene.hpp"
+#include "scenefile.hpp"
+#include "../util/error.hpp"
+#include "../util/trace.hpp"
+#include <filesystem>
+#include <utility>
+
+namespace {
+
+using SceneFactory = SceneDescription (*)();
+
+const std::vector<std::pair<std::string, SceneFactory>> scenes = {
+    {"manyballs", manyBalls},
+    {"manyballs-large", manyBallsLarge},
+    {"manyballs-huge", manyBallsHuge},
+    {"glassballs", glassBalls},
+};
+
+} // namespace
+
+std::vector<std::string> sceneNames() {
+    std::vector<std::string> names;
+    for (const auto &[name, factory] : scenes)
+        names.push_back(name);
+    return names;
+}
+
+bool sceneExists(const std::string &name) {
+    for (const auto &[n, factory] : scenes)
+        if (n == name)
+            return true;
+    return std::filesystem::is_regular_file(name);
+}
+
+SceneDescription loadScene(const std::string &name) {
+    TraceScope trace("load scene", "scene");
+    for (const auto &[n, factory] : scenes)
+        if (n == name)
+            return factory();
+    if (!std::filesystem::is_regular_file(name))
+        errorFatal("Unknown scene \"{}\"", name);
+    return isBinaryScene(name) ? loadBinaryScene(name) : loadSceneFile(name);
+}
+
+Scene makeScene(const std::string &name) {
+    SceneDescription desc = loadScene(name);
+    Scene scene(std::move(desc.world), desc.cam);
+    // --env-map on the command line wins over the file's light
+    if (!desc.envMap.empty() && Options->envMap.empty())
+        scene.envLight = EnvironmentLight::load(desc.envMap, desc.envMapScale);
+    return scene;
+}
@@ -1,5 +1,20 @@
 #pragma once
 
 #include "../scene.hpp"
+#include "scenefile.hpp"
+#include <string>
+#include <vector>
 
-Scene manyBalls();
+SceneDescription manyBalls();
+SceneDescription manyBallsLarge();
+SceneDescription manyBallsHuge();
+SceneDescription glassBalls();
+
+// built-in scenes selectable with --scene, in the order --help lists them
+std::vector<std::string> sceneNames();
+// a built-in scene name or the path of a scene file
+bool sceneExists(const std::string &name);
+// built-in scene, text scene file or binary scene; errorFatal()s on an unknown name
+SceneDescription loadScene(const std::string &name);
+// loadScene() plus the environment light, with command line overrides applied
+Scene makeScene(const std::string &name);
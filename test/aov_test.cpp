@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+
+#include "render/aov.hpp"
+
+TEST(Aov, Parse) {
+    EXPECT_EQ(0u, AovFilm::parse(""));
+    EXPECT_EQ(AovFilm::Albedo | AovFilm::Normal, AovFilm::parse("normal,albedo"));
+    EXPECT_EQ(AovFilm::Time, AovFilm::parse("time,"));
+    EXPECT_DEATH(AovFilm::parse("albedo,bogus"), "");
+}
+
+TEST(Aov, OnePartPerRequestedAov) {
+    AovFilm aovs(4, 2, AovFilm::parse("depth,primid,albedo"));
+    EXPECT_TRUE(aovs.needsHits());
+    EXPECT_FALSE(aovs.wants(AovFilm::Time));
+
+    auto specs = aovs.specs(OIIO::ImageSpec(4, 2, 3, OIIO::TypeDesc::FLOAT));
+    ASSERT_EQ(3u, specs.size());
+    EXPECT_EQ(3, specs[0].nchannels);
+    EXPECT_EQ(1, specs[1].nchannels);
+    EXPECT_EQ(OIIO::TypeDesc::UINT32, specs[2].format);
+}
+
+TEST(Aov, ResolveAveragesSamples) {
+    AovFilm aovs(2, 1, AovFilm::Albedo | AovFilm::Normal | AovFilm::Depth | AovFilm::PrimId |
+                       AovFilm::Samples | AovFilm::Time);
+
+    // pixel 0: two hits on different primitives, then a miss
+    AovSample hit0{color(1, 0, 0), Normal3f(0, 0, 1), 2, 7};
+    AovSample hit1{color(0, 1, 0), Normal3f(0, 1, 0), 4, 3};
+    aovs.addSample(0, 0, hit0);
+    aovs.addSample(0, 0, hit1);
+    aovs.addSample(0, 0, AovSample{});
+    aovs.addTime(0, 0, 100);
+    aovs.addTime(0, 0, 50);
+
+    // pixel 1: a single miss
+    aovs.addSample(1, 0, AovSample{});
+
+    Film film(2, 1, 2);
+    FilmTile tile;
+    tile.reset(film.bounds());
+    for (int i = 0; i < 3; ++i)
+        tile.addSample(Point2<int>(0, 0), color(1, 1, 1));
+    tile.addSample(Point2<int>(1, 0), color(1, 1, 1));
+    film.merge(tile);
+
+    // albedo and normal over all samples, misses counting as zero
+    std::vector<float> albedo = aovs.resolve(AovFilm::Albedo, film);
+    ASSERT_EQ(6u, albedo.size());
+    EXPECT_FLOAT_EQ(1.f / 3, albedo[0]);
+    EXPECT_FLOAT_EQ(1.f / 3, albedo[1]);
+    EXPECT_FLOAT_EQ(0, albedo[2]);
+    EXPECT_FLOAT_EQ(0, albedo[3]);
+
+    std::vector<float> normal = aovs.resolve(AovFilm::Normal, film);
+    EXPECT_FLOAT_EQ(0, normal[0]);
+    EXPECT_FLOAT_EQ(1.f / 3, normal[1]);
+    EXPECT_FLOAT_EQ(1.f / 3, normal[2]);
+
+    // depth over hits only
+    std::vector<float> depth = aovs.resolve(AovFilm::Depth, film);
+    ASSERT_EQ(2u, depth.size());
+    EXPECT_FLOAT_EQ(3, depth[0]);
+    EXPECT_EQ(std::numeric_limits<float>::infinity(), depth[1]);
+
+    EXPECT_EQ(8u, aovs.primId(0, 0));
+    EXPECT_EQ(0u, aovs.primId(1, 0));
+
+    std::vector<float> samples = aovs.resolve(AovFilm::Samples, film);
+    EXPECT_FLOAT_EQ(3, samples[0]);
+    EXPECT_FLOAT_EQ(1, samples[1]);
+
+    std::vector<float> time = aovs.resolve(AovFilm::Time, film);
+    EXPECT_FLOAT_EQ(150, time[0]);
+    EXPECT_FLOAT_EQ(0, time[1]);
+}
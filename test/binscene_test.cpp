@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "material.h"
+#include "worlds/binscene.hpp"
+
+class BinarySceneTest : public testing::Test {
+protected:
+    // sizeof(Header) in binscene.cpp
+    static constexpr long headerBytes = 256;
+
+    void SetUp() override { filename = testing::TempDir() + "binscene_test.rtsb"; }
+    void TearDown() override { std::remove(filename.c_str()); }
+
+    std::string filename;
+};
+
+TEST_F(BinarySceneTest, RoundTrip) {
+    SceneDescription s = parseScene(R"(
+image width 64 aspect 2 spp 3 depth 4
+camera lookfrom 1 2 3 lookat 0 0 0 up 0 1 0 fov 30 defocus 0.5 focus 7
+material a lambertian 0.1 0.2 0.3
+material b metal 0.4 0.5 0.6 0.25
+material c dielectric 1.33
+sphere a 0 0 0 1
+sphere c 1 2 3 0.5
+sphere b -1 0 4 2
+sphere a 5 5 5 0.1
+light environment "/sky.exr" scale 3
+)", "test.scene");
+    writeBinaryScene(s, filename);
+    ASSERT_TRUE(isBinaryScene(filename));
+
+    SceneDescription b = loadBinaryScene(filename);
+    EXPECT_TRUE(b.world.centers.mapped());
+    ASSERT_EQ(b.world.centers.size(), 4u);
+    for (std::size_t i = 0; i < 4; ++i) {
+        EXPECT_EQ(b.world.centers[i].center, s.world.centers[i].center);
+        EXPECT_EQ(b.world.centers[i].radius, s.world.centers[i].radius);
+        EXPECT_EQ(b.world.materialIds[i], s.world.materialIds[i]);
+    }
+
+    ASSERT_EQ(b.world.materials.size(), 3u);
+    for (std::size_t i = 0; i < 3; ++i) {
+        auto x = s.world.materials[i]->describe(), y = b.world.materials[i]->describe();
+        EXPECT_EQ(x->type, y->type);
+        EXPECT_EQ(x->albedo, y->albedo);
+        EXPECT_EQ(x->fuzz, y->fuzz);
+        EXPECT_EQ(x->ior, y->ior);
+    }
+
+    EXPECT_EQ(b.cam.image_width, 64);
+    EXPECT_EQ(b.cam.aspect_ratio, 2);
+    EXPECT_EQ(b.cam.samples_per_pixel, 3);
+    EXPECT_EQ(b.cam.lookfrom, Point3f(1, 2, 3));
+    EXPECT_EQ(b.cam.defocus_angle, 0.5);
+    EXPECT_EQ(b.envMap, "/sky.exr");
+    EXPECT_EQ(b.envMapScale, 3);
+
+    // copies own their data and outlive the mapping
+    Spheres copy = b.world;
+    b = SceneDescription();
+    EXPECT_FALSE(copy.centers.mapped());
+    EXPECT_EQ(copy.centers[3].radius, 0.1);
+}
+
+TEST_F(BinarySceneTest, Corrupted) {
+    SceneDescription s;
+    s.world.add({Point3f(0, 0, 0), 1}, std::make_shared<lambertian>(color(1, 1, 1)));
+    writeBinaryScene(s, filename);
+
+    std::FILE *f = std::fopen(filename.c_str(), "r+b");
+    ASSERT_TRUE(f);
+    // the sphere section starts right after the header, flip a byte of its center
+    std::fseek(f, headerBytes + 8, SEEK_SET);
+    std::fputc(0x55, f);
+    std::fclose(f);
+
+    EXPECT_DEATH(loadBinaryScene(filename), "checksum mismatch");
+}
+
+TEST_F(BinarySceneTest, Truncated) {
+    SceneDescription s;
+    s.world.add({Point3f(0, 0, 0), 1}, std::make_shared<lambertian>(color(1, 1, 1)));
+    writeBinaryScene(s, filename);
+    std::filesystem::resize_file(filename, headerBytes - 1);
+
+    EXPECT_DEATH(loadBinaryScene(filename), "truncated binary scene");
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "options.hpp"
+#include "render/checkpoint.hpp"
+
+class CheckpointTest : public testing::Test {
+protected:
+    void SetUp() override {
+        saved = Options;
+        Options = &options;
+        filename = testing::TempDir() + "checkpoint_test.ck";
+    }
+    void TearDown() override {
+        Options = saved;
+        std::remove(filename.c_str());
+    }
+
+    RaytracerOptions options;
+    RaytracerOptions *saved = nullptr;
+    std::string filename;
+};
+
+TEST_F(CheckpointTest, RoundTrip) {
+    Film film(13, 9, 4);
+    FilmTile tile;
+    tile.reset({Point2<int>(2, 1), Point2<int>(11, 9)});
+    for (int y = 1; y < 9; ++y)
+        for (int x = 2; x < 11; ++x)
+            tile.addSample(Point2<int>(x, y), color(x, y, 0.25), 0.5);
+    film.merge(tile);
+
+    {
+        Checkpointer checkpointer(filename);
+        checkpointer.save(film, 7);
+    }
+
+    Film restored(13, 9, 8);
+    EXPECT_EQ(7, loadCheckpoint(filename, restored));
+    for (int y = 0; y < 9; ++y)
+        for (int x = 0; x < 13; ++x) {
+            EXPECT_EQ(film.average(x, y), restored.average(x, y));
+            EXPECT_EQ(film.weight(x, y), restored.weight(x, y));
+            EXPECT_EQ(film.samples(x, y), restored.samples(x, y));
+        }
+}
+
+TEST_F(CheckpointTest, RejectsOtherSeed) {
+    Film film(4, 4, 4);
+    Checkpointer(filename).save(film, 1);
+
+    options.seed += 1;
+    std::string message = "checkpoint was rendered with seed " + std::to_string(options.seed - 1) + ", not " +
+                          std::to_string(options.seed);
+    EXPECT_DEATH(loadCheckpoint(filename, film), message);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "render/costmap.hpp"
+
+namespace {
+
+std::vector<std::vector<std::string>> readCsv(const std::string &filename) {
+    std::vector<std::vector<std::string>> rows;
+    std::ifstream in(filename);
+    for (std::string line; std::getline(in, line);) {
+        std::vector<std::string> &row = rows.emplace_back();
+        std::istringstream fields(line);
+        for (std::string field; std::getline(fields, field, ',');)
+            row.push_back(field);
+    }
+    return rows;
+}
+
+} // namespace
+
+class CostMapTest : public testing::Test {
+protected:
+    void SetUp() override { filename = testing::TempDir() + "costmap_test.csv"; }
+    void TearDown() override { std::remove(filename.c_str()); }
+
+    std::string filename;
+};
+
+// four 2x2 tiles of a 4x4 image, summed over two passes
+TEST_F(CostMapTest, TilesSlowestFirst) {
+    std::vector<Bounds2<int>> tiles;
+    for (int y = 0; y < 4; y += 2)
+        for (int x = 0; x < 4; x += 2)
+            tiles.emplace_back(Point2<int>(x, y), Point2<int>(x + 2, y + 2));
+    CostMap cost(4, 4, tiles);
+    for (int pass = 0; pass < 2; ++pass) {
+        cost.addTile(0, 1000000, 100);
+        cost.addTile(1, 3000000, 300);
+        cost.addTile(2, 500000, 50);
+        cost.addTile(3, 2000000, 100);
+    }
+    ASSERT_TRUE(cost.writeCsv(filename));
+
+    auto rows = readCsv(filename);
+    ASSERT_EQ(5u, rows.size());
+#ifdef NO_STATS
+    std::size_t columns = 8;
+#else
+    std::size_t columns = 10;
+#endif
+    EXPECT_EQ("rank", rows[0][0]);
+    EXPECT_EQ(columns, rows[0].size());
+
+    // rank, x, y, ms
+    const char *expected[4][4] = {
+        {"1", "2", "0", "6.000"}, {"2", "2", "2", "4.000"}, {"3", "0", "0", "2.000"}, {"4", "0", "2", "1.000"}};
+    for (int r = 0; r < 4; ++r) {
+        const std::vector<std::string> &row = rows[r + 1];
+        ASSERT_EQ(columns, row.size());
+        EXPECT_EQ(expected[r][0], row[0]);
+        EXPECT_EQ(expected[r][1], row[1]);
+        EXPECT_EQ(expected[r][2], row[2]);
+        EXPECT_EQ("2", row[3]);
+        EXPECT_EQ(expected[r][3], row[5]);
+    }
+    // 6 of 13 ms, and the median is the third slowest
+    EXPECT_EQ("46.15", rows[1][6]);
+    EXPECT_EQ("3.00", rows[1][7]);
+#ifndef NO_STATS
+    EXPECT_EQ("600", rows[1][8]);
+    EXPECT_EQ("10000.0", rows[1][9]);
+#endif
+}
+
+TEST(CostMap, HeatmapScalesToThe99thPercentile) {
+    // 200 pixels, so the 99th percentile skips exactly the slowest one
+    CostMap cost(20, 10, {});
+    for (int y = 0; y < 10; ++y)
+        for (int x = 0; x < 20; ++x)
+            if (y > 0 || x > 2)
+                cost.addPixel(x, y, 100);
+    cost.addPixel(1, 0, 25);
+    cost.addPixel(1, 0, 25);
+    cost.addPixel(2, 0, 1000000);
+
+    float fullScale = 0;
+    std::vector<uint8_t> rgb = cost.heatmap(&fullScale);
+    ASSERT_EQ(600u, rgb.size());
+    EXPECT_EQ(100.f, fullScale);
+
+    auto pixel = [&](int i) { return std::vector<uint8_t>(&rgb[3 * i], &rgb[3 * i + 3]); };
+    EXPECT_EQ((std::vector<uint8_t>{0x00, 0x00, 0x04}), pixel(0));  // free
+    EXPECT_EQ((std::vector<uint8_t>{0xba, 0x36, 0x55}), pixel(1));  // half the full scale
+    EXPECT_EQ((std::vector<uint8_t>{0xfc, 0xff, 0xa4}), pixel(3));  // full scale
+    EXPECT_EQ(pixel(3), pixel(2));                                  // the outlier saturates
+}
+
+TEST(CostMap, IdleHeatmapIsBlack) {
+    CostMap cost(4, 4, {});
+    float fullScale = -1;
+    std::vector<uint8_t> rgb = cost.heatmap(&fullScale);
+    EXPECT_EQ(0.f, fullScale);
+    for (std::size_t i = 0; i < rgb.size(); i += 3)
+        EXPECT_EQ(4, rgb[i + 2]);
+}
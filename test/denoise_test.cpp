@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+
+#include "render/denoise.hpp"
+
+namespace {
+
+struct Image {
+    Image(int w, int h) : w(w), h(h), rgb(3 * w * h), albedo(3 * w * h, 0.5f), normal(3 * w * h) {
+        for (int i = 0; i < w * h; ++i)
+            normal[3 * i + 2] = 1.f;
+    }
+
+    float variance(const std::vector<float> &img, int x0, int x1) const {
+        double sum = 0, sumSq = 0;
+        int n = 0;
+        for (int y = 0; y < h; ++y)
+            for (int x = x0; x < x1; ++x, ++n) {
+                sum += img[3 * (y * w + x)];
+                sumSq += img[3 * (y * w + x)] * img[3 * (y * w + x)];
+            }
+        return float(sumSq / n - (sum / n) * (sum / n));
+    }
+
+    int w, h;
+    std::vector<float> rgb, albedo, normal;
+};
+
+} // namespace
+
+TEST(Denoise, ConstantImageUnchanged) {
+    Image img(70, 40);
+    std::fill(img.rgb.begin(), img.rgb.end(), 0.25f);
+
+    auto out = denoise(img.w, img.h, img.rgb, img.albedo, img.normal);
+    for (float v : out)
+        EXPECT_NEAR(0.25f, v, 1e-5f);
+}
+
+TEST(Denoise, ReducesNoiseAndKeepsAlbedoEdges) {
+    Image img(64, 32);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(0.5f, 1.5f);
+
+    // left half dark, right half bright albedo, same noisy lighting
+    for (int y = 0; y < img.h; ++y)
+        for (int x = 0; x < img.w; ++x) {
+            int i = y * img.w + x;
+            float a = x < img.w / 2 ? 0.1f : 0.9f;
+            float L = noise(rng);
+            for (int c = 0; c < 3; ++c) {
+                img.albedo[3 * i + c] = a;
+                img.rgb[3 * i + c] = a * L;
+            }
+        }
+
+    auto out = denoise(img.w, img.h, img.rgb, img.albedo, img.normal);
+
+    EXPECT_LT(img.variance(out, img.w / 2, img.w), 0.25f * img.variance(img.rgb, img.w / 2, img.w));
+    // the pixels on either side of the edge keep their own albedo
+    int y = img.h / 2;
+    EXPECT_NEAR(0.1f, out[3 * (y * img.w + img.w / 2 - 1)], 0.05f);
+    EXPECT_NEAR(0.9f, out[3 * (y * img.w + img.w / 2)], 0.3f);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include "render/display.hpp"
+
+TEST(DisplayTransform, ClampGamma2) {
+    float rgb[6] = {0.25f, 4.f, -1.f, 0.f, 0.81f, 1.f};
+    DisplayTransform(0.f, ToneMap::Clamp, Transfer::Gamma2).apply(rgb, 2);
+
+    EXPECT_FLOAT_EQ(0.5f, rgb[0]);
+    EXPECT_FLOAT_EQ(0.999f, rgb[1]);
+    EXPECT_FLOAT_EQ(0.f, rgb[2]);
+    EXPECT_FLOAT_EQ(0.f, rgb[3]);
+    EXPECT_FLOAT_EQ(0.9f, rgb[4]);
+    EXPECT_FLOAT_EQ(0.999f, rgb[5]);
+}
+
+TEST(DisplayTransform, ExposureAndNoneKeepHDR) {
+    float rgb[3] = {1.f, 3.f, 0.5f};
+    DisplayTransform(1.f, ToneMap::None, Transfer::Linear).apply(rgb, 1);
+
+    EXPECT_FLOAT_EQ(2.f, rgb[0]);
+    EXPECT_FLOAT_EQ(6.f, rgb[1]);
+    EXPECT_FLOAT_EQ(1.f, rgb[2]);
+}
+
+TEST(DisplayTransform, CurvesStayInRange) {
+    for (ToneMap tm : {ToneMap::Reinhard, ToneMap::Aces})
+        for (Transfer tf : {Transfer::Linear, Transfer::Gamma2, Transfer::SRGB}) {
+            float rgb[6] = {0.f, 1e-3f, 0.18f, 1.f, 10.f, 1e6f};
+            DisplayTransform(0.f, tm, tf).apply(rgb, 2);
+            for (int i = 0; i < 6; ++i) {
+                EXPECT_GE(rgb[i], 0.f);
+                EXPECT_LE(rgb[i], 1.f);
+                if (i > 0)
+                    EXPECT_GE(rgb[i], rgb[i - 1]);
+            }
+        }
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include "render/film.hpp"
+
+TEST(Film, UnmergedPixelsAreBlack) {
+    Film film(10, 7, 4);
+    EXPECT_EQ(color(0, 0, 0), film.average(3, 3));
+    EXPECT_EQ(0, film.weight(9, 6));
+}
+
+TEST(Film, MergeAveragesSamples) {
+    Film film(10, 7, 4);
+
+    FilmTile tile;
+    tile.reset({Point2<int>(2, 1), Point2<int>(9, 7)});
+    tile.addSample(Point2<int>(5, 5), color(1, 2, 3));
+    tile.addSample(Point2<int>(5, 5), color(3, 2, 1));
+    film.merge(tile);
+
+    EXPECT_EQ(color(2, 2, 2), film.average(5, 5));
+    EXPECT_EQ(2, film.weight(5, 5));
+    EXPECT_EQ(0, film.weight(2, 1));
+}
+
+TEST(Film, PassesAccumulate) {
+    Film film(8, 8, 8);
+    FilmTile tile;
+
+    for (int pass = 0; pass < 4; ++pass) {
+        tile.reset(film.bounds());
+        for (int y = 0; y < 8; ++y)
+            for (int x = 0; x < 8; ++x)
+                tile.addSample(Point2<int>(x, y), color(pass, x, y));
+        film.merge(tile);
+    }
+
+    EXPECT_EQ(4, film.weight(7, 7));
+    EXPECT_EQ(color(1.5, 3, 6), film.average(3, 6));
+}
+
+TEST(Film, TileSpanningBlocks) {
+    Film film(9, 9, 4);
+
+    FilmTile tile;
+    tile.reset({Point2<int>(1, 1), Point2<int>(9, 9)});
+    for (int y = 1; y < 9; ++y)
+        for (int x = 1; x < 9; ++x)
+            tile.addSample(Point2<int>(x, y), color(x, y, 1), 0.5);
+    film.merge(tile);
+
+    for (int y = 1; y < 9; ++y)
+        for (int x = 1; x < 9; ++x) {
+            EXPECT_EQ(color(x, y, 1), film.average(x, y));
+            EXPECT_EQ(0.5, film.weight(x, y));
+        }
+}
+
+TEST(Film, NoiseEstimate) {
+    Film film(4, 4, 4);
+    FilmTile tile;
+    tile.reset(film.bounds());
+
+    // constant samples have no variance
+    for (int s = 0; s < 4; ++s)
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                tile.addSample(Point2<int>(x, y), color(1, 1, 1));
+    film.merge(tile);
+    EXPECT_EQ(4, film.samples(2, 2));
+    EXPECT_NEAR(0, film.estimateNoise(), 1e-6);
+
+    // four more samples alternating 2 and 0: mean 1, variance 4/7 over 8 samples
+    tile.reset(film.bounds());
+    for (int s = 0; s < 4; ++s)
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                tile.addSample(Point2<int>(x, y), s % 2 ? color(0, 0, 0) : color(2, 2, 2));
+    film.merge(tile);
+    EXPECT_NEAR(std::sqrt(4. / 7. / 8.), film.estimateNoise(), 1e-5);
+}
+
+TEST(Film, BoxSplatStaysInPixel) {
+    Filter box(FilterType::Box);
+    EXPECT_EQ(0, box.apron());
+
+    FilmTile tile;
+    tile.reset({Point2<int>(0, 0), Point2<int>(4, 4)});
+    tile.splat(Point2f(1.3, 2.7), color(1, 2, 3), box);
+
+    EXPECT_EQ(1, tile.pixel(Point2<int>(1, 2)).weight);
+    EXPECT_EQ(3, tile.pixel(Point2<int>(1, 2)).rgb[2]);
+    EXPECT_EQ(0, tile.pixel(Point2<int>(2, 2)).weight);
+    EXPECT_EQ(0, tile.pixel(Point2<int>(1, 3)).weight);
+}
+
+TEST(Film, WideFilterSplatsAcrossTiles) {
+    Filter gaussian(FilterType::Gaussian, 1.5f);
+    EXPECT_EQ(1, gaussian.apron());
+
+    Film film(8, 4, 4);
+    Bounds2<int> left(Point2<int>(0, 0), Point2<int>(4, 4));
+    Bounds2<int> padded = FilmTile::paddedBounds(left, gaussian, film.bounds());
+    EXPECT_EQ(Point2<int>(5, 4), padded.pMax);
+
+    // a sample on the right edge of the left tile reaches the right tile's first column
+    FilmTile tile;
+    tile.reset(padded);
+    tile.splat(Point2f(3.9, 1.5), color(1, 1, 1), gaussian);
+    film.merge(tile);
+
+    EXPECT_GT(film.weight(4, 1), 0);
+    EXPECT_GT(film.weight(3, 1), film.weight(4, 1));
+    EXPECT_EQ(0, film.weight(1, 1));
+    EXPECT_EQ(1, film.samples(3, 1));
+    EXPECT_EQ(0, film.samples(4, 1));
+}
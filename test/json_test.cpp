@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include "util/json.hpp"
+
+TEST(Json, Parse) {
+    JsonValue v = parseJson(R"({
+        "name": "many \"balls\"",
+        "wall_ms": 12.5,
+        "runs": [1, -2e3, true, false, null],
+        "nested": {"empty": [], "obj": {}}
+    })", "test.json");
+
+    ASSERT_EQ(v.type, JsonValue::Type::Object);
+    EXPECT_EQ(v.string("name"), "many \"balls\"");
+    EXPECT_EQ(v.number("wall_ms", 0), 12.5);
+    EXPECT_EQ(v.number("missing", -1), -1);
+    EXPECT_EQ(v.number("name", -1), -1);
+
+    const JsonValue *runs = v.find("runs");
+    ASSERT_TRUE(runs);
+    ASSERT_EQ(runs->items.size(), 5);
+    EXPECT_EQ(runs->items[1].num, -2000);
+    EXPECT_TRUE(runs->items[2].boolean);
+    EXPECT_EQ(runs->items[3].type, JsonValue::Type::Bool);
+    EXPECT_FALSE(runs->items[3].boolean);
+    EXPECT_EQ(runs->items[4].type, JsonValue::Type::Null);
+
+    const JsonValue *nested = v.find("nested");
+    ASSERT_TRUE(nested);
+    EXPECT_TRUE(nested->find("empty")->items.empty());
+    EXPECT_EQ(nested->find("obj")->type, JsonValue::Type::Object);
+}
+
+TEST(Json, QuoteRoundTrip) {
+    std::string text = "a\"b\\c\nd\te";
+    EXPECT_EQ(parseJson(jsonQuote(text), "q").str, text);
+}
+
+TEST(Json, Errors) {
+    EXPECT_DEATH(parseJson("{\"a\": 1,}", "bad.json"), "");
+    EXPECT_DEATH(parseJson("[1, 2", "bad.json"), "");
+    EXPECT_DEATH(parseJson("{} x", "bad.json"), "");
+    EXPECT_DEATH(parseJson("\"open", "bad.json"), "");
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "options.hpp"
+
+namespace {
+
+RaytracerOptions parse(std::initializer_list<const char *> args) {
+    std::vector<std::string> storage{"raytracer"};
+    storage.insert(storage.end(), args.begin(), args.end());
+    std::vector<char *> argv;
+    for (auto &s : storage)
+        argv.push_back(s.data());
+
+    RaytracerOptions options;
+    parseCommandLine(int(argv.size()), argv.data(), options);
+    return options;
+}
+
+} // namespace
+
+TEST(Options, Defaults) {
+    RaytracerOptions options = parse({});
+    RaytracerOptions defaults;
+    EXPECT_EQ(options.scene, defaults.scene);
+    EXPECT_EQ(options.spp, 0);
+    EXPECT_EQ(options.outFile, defaults.outFile);
+}
+
+TEST(Options, Values) {
+    RaytracerOptions o = parse({"--threads", "3", "--seed=42", "--spp", "64", "--resolution", "320x200",
+                                "--max-depth", "5", "-o", "out.exr", "--log-level", "error",
+                                "--profile", "--tile-size=16", "--mode", "progressive"});
+    EXPECT_EQ(o.nThreads, 3);
+    EXPECT_EQ(o.seed, 42u);
+    EXPECT_EQ(o.spp, 64);
+    EXPECT_EQ(o.width, 320);
+    EXPECT_EQ(o.height, 200);
+    EXPECT_EQ(o.maxDepth, 5);
+    EXPECT_EQ(o.outFile, "out.exr");
+    EXPECT_EQ(o.logLevel, LogLevel::Error);
+    EXPECT_TRUE(o.profiling);
+    EXPECT_EQ(o.tileSize, 16);
+    EXPECT_EQ(o.renderMode, RenderMode::Progressive);
+}
+
+TEST(Options, Invalid) {
+    EXPECT_EXIT(parse({"--threads", "0"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--spp", "12abc"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--resolution", "640"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--mode", "fast"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--scene", "nosuchscene"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--bogus"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--seed"}), testing::ExitedWithCode(2), "");
+    EXPECT_EXIT(parse({"--profile=yes"}), testing::ExitedWithCode(2), "");
+}
+
+TEST(Options, Help) {
+    EXPECT_EXIT(parse({"--help"}), testing::ExitedWithCode(0), "");
+}
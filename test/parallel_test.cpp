@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <vector>
+
+#include "util/parallel.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct PoolScope {
+    explicit PoolScope(int n) : pool(n) { threadPool = &pool; }
+    ~PoolScope() { threadPool = nullptr; }
+    ThreadPool pool;
+};
+
+TEST(Parallel, ForVisitsEveryIndexOnce) {
+    PoolScope scope(4);
+
+    std::vector<std::atomic<int>> visits(10007);
+    parallelFor(0, visits.size(), [&](int64_t i) { visits[i].fetch_add(1); });
+
+    for (auto &v : visits)
+        EXPECT_EQ(1, v.load());
+}
+
+TEST(Parallel, ForWithoutPoolRunsSerially) {
+    ASSERT_EQ(nullptr, threadPool);
+
+    int64_t sum = 0;
+    parallelFor(0, 100, [&](int64_t i) { sum += i; });
+    EXPECT_EQ(4950, sum);
+}
+
+TEST(Parallel, ForOrderedStartsInOrder) {
+    PoolScope scope(4);
+
+    std::vector<std::atomic<int>> visits(1000);
+    std::vector<int64_t> started(visits.size());
+    std::atomic<int> nextSlot{0};
+    parallelForOrdered(0, visits.size(), [&](int64_t i) {
+        started[nextSlot.fetch_add(1)] = i;
+        visits[i].fetch_add(1);
+        // long enough for every worker to join in
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    });
+
+    for (auto &v : visits)
+        EXPECT_EQ(1, v.load());
+    // when i starts every smaller index has been handed out, and at most one
+    // per other thread is not in started yet, so nothing starts early
+    for (std::size_t k = 0; k < started.size(); ++k)
+        EXPECT_LE(started[k], int64_t(k) + 3) << k;
+}
+
+TEST(Parallel, For2DCoversExtent) {
+    PoolScope scope(3);
+
+    constexpr int W = 67, H = 41;
+    std::vector<std::atomic<int>> visits(W * H);
+    Bounds2<int> extent(Point2<int>(0, 0), Point2<int>(W, H));
+
+    parallelFor2D(extent, 16, [&](Bounds2<int> tile) {
+        for (int y = tile.pMin.y; y < tile.pMax.y; ++y)
+            for (int x = tile.pMin.x; x < tile.pMax.x; ++x)
+                visits[y * W + x].fetch_add(1);
+    });
+
+    for (auto &v : visits)
+        EXPECT_EQ(1, v.load());
+}
+
+TEST(Parallel, NestedForkJoin) {
+    PoolScope scope(4);
+
+    std::function<int64_t(int64_t)> fib = [&](int64_t n) -> int64_t {
+        if (n < 12)
+            return n < 2 ? n : fib(n - 1) + fib(n - 2);
+        int64_t a = 0;
+        TaskGroup group;
+        group.run([&]() { a = fib(n - 1); });
+        int64_t b = fib(n - 2);
+        group.wait();
+        return a + b;
+    };
+
+    EXPECT_EQ(10946, fib(21));
+}
+
+namespace {
+
+double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+} // namespace
+
+TEST(Parallel, WaitSleepsInsteadOfSpinning) {
+    PoolScope scope(2);
+
+    std::atomic<bool> started{false}, done{false};
+    TaskGroup group;
+    group.run([&]() {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        done = true;
+    });
+    // make sure the worker has the task, so this thread has nothing to run
+    while (!started)
+        std::this_thread::yield();
+
+    double cpuStart = threadCpuSeconds();
+    group.wait();
+    EXPECT_TRUE(done);
+    EXPECT_LT(threadCpuSeconds() - cpuStart, 0.05);
+}
+
+TEST(Parallel, ThreadsOutsideThePoolRunSerially) {
+    PoolScope scope(4);
+
+    std::thread outside([]() {
+        EXPECT_EQ(-1, ThreadPool::threadIndex());
+        std::thread::id self = std::this_thread::get_id();
+        std::atomic<int> foreign{0};
+        parallelFor(0, 256, [&](int64_t) { foreign += std::this_thread::get_id() != self; });
+        parallelForOrdered(0, 256, [&](int64_t) { foreign += std::this_thread::get_id() != self; });
+        EXPECT_EQ(0, foreign.load());
+    });
+    // keep the pool busy meanwhile, the outside thread must not pick up this work
+    std::atomic<int> seenOutside{0};
+    parallelFor(0, 256, [&](int64_t) {
+        seenOutside += ThreadPool::threadIndex() < 0;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    });
+    outside.join();
+    EXPECT_EQ(0, seenOutside.load());
+}
+
+TEST(Parallel, WorkerIndices) {
+    PoolScope scope(4);
+    EXPECT_EQ(0, ThreadPool::threadIndex());
+
+    std::vector<std::atomic<int>> seen(4);
+    parallelFor(0, 256, [&](int64_t) {
+        int idx = ThreadPool::threadIndex();
+        ASSERT_GE(idx, 0);
+        ASSERT_LT(idx, 4);
+        seen[idx].fetch_add(1);
+    });
+
+    int total = 0;
+    for (auto &s : seen)
+        total += s.load();
+    EXPECT_EQ(256, total);
+}
+
+#ifdef __linux__
+TEST(Parallel, PinsWorkersOnly) {
+    cpu_set_t before;
+    ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(before), &before));
+
+    std::vector<int> cpusAllowed(3, -1);
+    {
+        ThreadPool pool(3, true);
+        threadPool = &pool;
+        parallelForOrdered(0, 64, [&](int64_t) {
+            cpu_set_t set;
+            pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            cpusAllowed[ThreadPool::threadIndex()] = CPU_COUNT(&set);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        });
+        threadPool = nullptr;
+    }
+
+    // the caller, and so every thread it starts, keeps its affinity
+    cpu_set_t after;
+    ASSERT_EQ(0, pthread_getaffinity_np(pthread_self(), sizeof(after), &after));
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+    EXPECT_EQ(CPU_COUNT(&before), cpusAllowed[0]);
+    for (int i = 1; i < 3; ++i)
+        if (cpusAllowed[i] != -1)
+            EXPECT_EQ(1, cpusAllowed[i]) << "worker " << i;
+}
+#endif
@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+
+#include "util/perfcounters.hpp"
+
+TEST(PerfCounters, ClosedReadsZero) {
+    PerfCounters pc;
+    EXPECT_FALSE(pc.isOpen());
+    EXPECT_FALSE(pc.has(PerfEvent::Cycles));
+    EXPECT_EQ(pc.read()[PerfEvent::Instructions], 0);
+}
+
+// counters are often unavailable in CI containers, which must not be an error
+TEST(PerfCounters, CountsWhenAvailable) {
+    PerfCounters pc;
+    std::string why;
+    if (!pc.open(&why))
+        GTEST_SKIP() << "no hardware counters: " << why;
+
+    PerfValues start = pc.read();
+    volatile double x = 0;
+    for (int i = 0; i < 1000000; ++i)
+        x = x + i;
+    PerfValues d = pc.read() - start;
+    if (pc.has(PerfEvent::Instructions)) {
+        EXPECT_GT(d[PerfEvent::Instructions], 1000000);
+    }
+
+    pc.close();
+    EXPECT_FALSE(pc.isOpen());
+}
@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+// this file checks what a -DENABLE_PROFILING=OFF build compiles to
+#ifndef NO_PROFILING
+#define NO_PROFILING
+#endif
+#include "util/profiler.hpp"
+
+TEST(ProfilerDisabled, ScopesCompileOut) {
+    profiler.init();
+    int before = profiler.registerScope("disabled probe 1");
+    {
+        PROFILE_SCOPE("disabled scope");
+        PROFILE_SCOPE_COUNTERS("disabled counters");
+        PROFILE_SCOPE_DETAIL("disabled detail");
+    }
+    profiler.profiling = false;
+
+    // nothing registered and nothing recorded
+    EXPECT_EQ(before + 1, profiler.registerScope("disabled probe 2"));
+    for (const Profiler::Entry &e : profiler.merged()) {
+        EXPECT_NE("disabled scope", e.name);
+        EXPECT_NE("disabled counters", e.name);
+        EXPECT_NE("disabled detail", e.name);
+    }
+}
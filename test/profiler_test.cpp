@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "util/parallel.hpp"
+#include "util/profiler.hpp"
+
+#ifndef NO_PROFILING
+
+namespace {
+
+// index of the entry with this name under parent, -1 if there is none
+int child(const std::vector<Profiler::Entry> &entries, int parent, std::string_view name) {
+    int found = -1;
+    for (int i = 1; i < int(entries.size()); ++i)
+        if (entries[i].parent == parent && entries[i].name == name) {
+            EXPECT_EQ(-1, found) << name << " appears twice under one parent";
+            found = i;
+        }
+    return found;
+}
+
+void profiledCall() {
+    PROFILE_SCOPE("test call site");
+}
+
+} // namespace
+
+TEST(Profiler, ScopeIdsAreSharedByName) {
+    int a = profiler.registerScope("test shared");
+    EXPECT_EQ(a, profiler.registerScope("test shared"));
+    EXPECT_NE(a, profiler.registerScope("test other"));
+}
+
+TEST(Profiler, CallSitesRegisterOnce) {
+    // a fresh name gets the next id, so ids count the names registered in between
+    int before = profiler.registerScope("test probe 1");
+    for (int i = 0; i < 100; ++i)
+        profiledCall();
+    EXPECT_EQ(before + 2, profiler.registerScope("test probe 2"));
+}
+
+TEST(Profiler, DetailScopes) {
+    profiler.init();
+    {
+        PROFILE_SCOPE_DETAIL("test detail");
+    }
+    profiler.profiling = false;
+
+#ifdef PROFILING_DETAIL
+    EXPECT_NE(-1, child(profiler.merged(), 0, "test detail"));
+#else
+    EXPECT_EQ(-1, child(profiler.merged(), 0, "test detail"));
+#endif
+}
+
+TEST(Profiler, MergesThreadTrees) {
+    ThreadPool pool(4);
+    threadPool = &pool;
+    profiler.init();
+
+    std::atomic<int> workerCalls{0};
+    parallelFor(0, 400, [&](int64_t i) {
+        PROFILE_SCOPE("test outer");
+        {
+            PROFILE_SCOPE("test inner");
+            if (i % 2 == 0) {
+                PROFILE_SCOPE("test leaf");
+            }
+        }
+        workerCalls += ThreadPool::threadIndex() > 0;
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    });
+    threadPool = nullptr;
+    profiler.profiling = false;
+
+    auto entries = profiler.merged();
+    int outer = child(entries, 0, "test outer");
+    ASSERT_NE(-1, outer);
+    int inner = child(entries, outer, "test inner");
+    ASSERT_NE(-1, inner);
+    int leaf = child(entries, inner, "test leaf");
+    ASSERT_NE(-1, leaf);
+
+    EXPECT_EQ(400u, entries[outer].calls);
+    EXPECT_EQ(400u, entries[inner].calls);
+    EXPECT_EQ(200u, entries[leaf].calls);
+    EXPECT_EQ(-1, child(entries, 0, "test inner"));
+    EXPECT_EQ(-1, child(entries, outer, "test leaf"));
+    // otherwise this only tested a single thread's tree
+    EXPECT_GT(workerCalls.load(), 0);
+}
+
+#ifdef __linux__
+TEST(Profiler, CountersCloseWithTheirThread) {
+    profiler.init(ProfileClock::Steady, true);
+    if (!profiler.counting) {
+        profiler.profiling = false;
+        GTEST_SKIP() << "no hardware counters";
+    }
+    auto openFds = []() {
+        auto it = std::filesystem::directory_iterator("/proc/self/fd");
+        return std::distance(begin(it), end(it));
+    };
+
+    auto before = openFds();
+    for (int i = 0; i < 4; ++i) {
+        std::thread t([]() { PROFILE_SCOPE_COUNTERS("test counters"); });
+        t.join();
+    }
+    profiler.profiling = false;
+    EXPECT_EQ(before, openFds());
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#include "util/sampling.hpp"
+#include "lights.hpp"
+
+TEST(PiecewiseConstant1D, Uniform) {
+    std::vector<Float> func{1, 1, 1, 1};
+    PiecewiseConstant1D dist(func);
+
+    EXPECT_EQ(4, dist.size());
+    EXPECT_NEAR(1, dist.integral(), 1e-12);
+
+    for (Float u : {0.0, 0.1, 0.25, 0.5, 0.8, 0.999}) {
+        Float pdf;
+        EXPECT_NEAR(u, dist.sample(u, &pdf), 1e-12);
+        EXPECT_NEAR(1, pdf, 1e-12);
+    }
+}
+
+TEST(PiecewiseConstant1D, NonUniform) {
+    std::vector<Float> func{0, 1, 0, 3};
+    PiecewiseConstant1D dist(func);
+
+    EXPECT_NEAR(1, dist.integral(), 1e-12);
+
+    Float pdf;
+    int offset;
+    Float x = dist.sample(0.1, &pdf, &offset);
+    EXPECT_EQ(1, offset);
+    EXPECT_NEAR(1, pdf, 1e-12);
+    EXPECT_NEAR(0.25 + 0.4 * 0.25, x, 1e-12);
+
+    x = dist.sample(0.5, &pdf, &offset);
+    EXPECT_EQ(3, offset);
+    EXPECT_NEAR(3, pdf, 1e-12);
+    EXPECT_NEAR(0.75 + 0.25 / 3, x, 1e-12);
+}
+
+TEST(PiecewiseConstant1D, AllZero) {
+    std::vector<Float> func{0, 0, 0};
+    PiecewiseConstant1D dist(func);
+
+    Float pdf;
+    Float x = dist.sample(0.5, &pdf);
+    EXPECT_EQ(0, pdf);
+    EXPECT_GE(x, 0);
+    EXPECT_LT(x, 1);
+}
+
+TEST(PiecewiseConstant2D, PdfMatchesSample) {
+    constexpr int nu = 8, nv = 5;
+    std::vector<Float> func(nu * nv);
+    for (int v = 0; v < nv; ++v)
+        for (int u = 0; u < nu; ++u)
+            func[v * nu + u] = 1 + u * v + (u == 3 ? 10 : 0);
+
+    PiecewiseConstant2D dist(func, nu, nv);
+
+    for (Float a : {0.05, 0.3, 0.61, 0.97})
+        for (Float b : {0.02, 0.45, 0.77, 0.99}) {
+            Float pdf;
+            Point2f p = dist.sample(Point2f(a, b), &pdf);
+            EXPECT_GE(p.x, 0);
+            EXPECT_LT(p.x, 1);
+            EXPECT_GE(p.y, 0);
+            EXPECT_LT(p.y, 1);
+            EXPECT_NEAR(pdf, dist.pdf(p), 1e-9);
+        }
+}
+
+TEST(PiecewiseConstant2D, IntegratesToOne) {
+    constexpr int nu = 16, nv = 16;
+    std::vector<Float> func(nu * nv);
+    for (int i = 0; i < nu * nv; ++i)
+        func[i] = (i * 7919) % 13;
+
+    PiecewiseConstant2D dist(func, nu, nv);
+
+    Float sum = 0;
+    for (int v = 0; v < nv; ++v)
+        for (int u = 0; u < nu; ++u)
+            sum += dist.pdf(Point2f((u + 0.5) / nu, (v + 0.5) / nv));
+    EXPECT_NEAR(1, sum / (nu * nv), 1e-9);
+}
+
+TEST(EnvironmentLight, EquirectRoundTrip) {
+    for (Vector3f d : {Vector3f(1, 0, 0), Vector3f(0, 0.5, 1), Vector3f(-0.3, -0.2, 0.9),
+                       Vector3f(0.1, 0.9, -0.4)}) {
+        Vector3f w = normalize(d);
+        Vector3f r = directionFromEquirect(equirectFromDirection(w));
+        EXPECT_NEAR(w.x, r.x, 1e-9);
+        EXPECT_NEAR(w.y, r.y, 1e-9);
+        EXPECT_NEAR(w.z, r.z, 1e-9);
+    }
+}
+
+TEST(EnvironmentLight, SamplesBrightTexels) {
+    constexpr int w = 16, h = 8;
+    std::vector<float> texels(w * h * 3, 0.01f);
+    // one bright texel near the horizon
+    for (int c = 0; c < 3; ++c)
+        texels[(4 * w + 5) * 3 + c] = 100.f;
+
+    EnvironmentLight env(w, h, texels);
+
+    int bright = 0;
+    for (int i = 0; i < 64; ++i) {
+        auto ls = env.sample(Point2f((i + 0.5) / 64, 0.5));
+        ASSERT_TRUE(ls.has_value());
+        EXPECT_NEAR(ls->pdf, env.pdf(ls->wi), 1e-6 * ls->pdf);
+        if (ls->L.x > 1) ++bright;
+    }
+    EXPECT_GT(bright, 48);
+}
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+#include "benchmark/scaling.hpp"
+#include "options.hpp"
+#include "util/parallel.hpp"
+#include "worlds/worlds.hpp"
+
+TEST(Scaling, ThreadCounts) {
+    EXPECT_EQ(scalingThreadCounts(1), std::vector<int>({1}));
+    EXPECT_EQ(scalingThreadCounts(2), std::vector<int>({1, 2}));
+    EXPECT_EQ(scalingThreadCounts(8), std::vector<int>({1, 2, 4, 8}));
+    EXPECT_EQ(scalingThreadCounts(12), std::vector<int>({1, 2, 4, 8, 12}));
+    EXPECT_EQ(scalingThreadCounts(0), std::vector<int>({1}));
+}
+
+TEST(Scaling, Point) {
+    RenderStats best;
+    best.wallNs = 4000000;
+    best.busyNs = {4000000, 3000000, 5000000, 2000000};
+    ScalingPoint p = makeScalingPoint(4, best, 12000000);
+    EXPECT_EQ(4, p.threads);
+    EXPECT_DOUBLE_EQ(3, p.speedup);
+    EXPECT_DOUBLE_EQ(0.75, p.efficiency);
+    // busy longer than the wall clock counts as never idle
+    EXPECT_EQ(std::vector<double>({0, 1, 0, 2}), p.idleMs);
+    EXPECT_DOUBLE_EQ(0.1875, p.meanIdle);
+    EXPECT_DOUBLE_EQ(0.5, p.maxIdle);
+}
+
+TEST(Scaling, Measure) {
+    RaytracerOptions options;
+    options.width = 16;
+    options.height = 8;
+    options.spp = 1;
+    options.nThreads = 3;
+    options.benchRuns = 2;
+    options.logLevel = LogLevel::Warning;
+    options.outFile = testing::TempDir() + "scaling_test.exr";
+    std::filesystem::remove(options.outFile);
+    RaytracerOptions *saved = Options;
+    Options = &options;
+    ThreadPool *savedPool = threadPool;
+    threadPool = nullptr;
+
+    std::vector<ScalingPoint> points = measureScaling(makeScene(options.scene));
+    delete threadPool;
+    threadPool = savedPool;
+    Options = saved;
+
+    ASSERT_EQ(3u, points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        const ScalingPoint &p = points[i];
+        EXPECT_EQ(scalingThreadCounts(3)[i], p.threads);
+        EXPECT_EQ(std::size_t(p.threads), p.best.busyNs.size());
+        EXPECT_EQ(std::size_t(p.threads), p.idleMs.size());
+        EXPECT_EQ(1, p.best.samplesPerPixel);
+        EXPECT_GT(p.best.wallNs, 0);
+        // every count traces the same rays
+        EXPECT_EQ(points[0].best.rays.totalRays(), p.best.rays.totalRays());
+    }
+    EXPECT_DOUBLE_EQ(1, points[0].speedup);
+    EXPECT_FALSE(std::filesystem::exists(options.outFile));
+    // the caller's options are left as they were
+    EXPECT_TRUE(options.adaptiveTiles);
+    EXPECT_TRUE(options.writeOutput);
+}
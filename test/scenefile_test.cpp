@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+
+#include "worlds/scenefile.hpp"
+
+TEST(SceneFile, Basic) {
+    SceneDescription s = parseScene(R"(
+# comment
+image width 320 height 200 spp 7 depth 3   # trailing comment
+camera lookfrom 1 2 3 lookat 0 0 0 up 0 1 0 fov 45
+material red lambertian 0.8 0.1 0.1
+material glass dielectric 1.5
+sphere red 0 -100 0 100
+sphere glass 0 1 0 1
+)", "test.scene");
+
+    EXPECT_EQ(s.cam.image_width, 320);
+    EXPECT_EQ(s.cam.image_height, 200);
+    EXPECT_EQ(s.cam.samples_per_pixel, 7);
+    EXPECT_EQ(s.cam.max_depth, 3);
+    EXPECT_EQ(s.cam.vfov, 45);
+    EXPECT_EQ(s.cam.lookfrom, Point3f(1, 2, 3));
+
+    ASSERT_EQ(s.world.centers.size(), 2u);
+    ASSERT_EQ(s.world.materials.size(), 2u);
+    EXPECT_EQ(s.world.centers[0].radius, 100);
+    EXPECT_EQ(s.world.centers[1].center, Point3f(0, 1, 0));
+    EXPECT_EQ(s.world.materialIds[0], 0u);
+    EXPECT_EQ(s.world.materialIds[1], 1u);
+    EXPECT_TRUE(s.envMap.empty());
+}
+
+TEST(SceneFile, Instances) {
+    SceneDescription s = parseScene(R"(
+material m lambertian 1 1 1
+object ball
+sphere m 1 0 0 0.5
+end
+object two
+instance ball
+instance ball translate 0 0 4
+end
+instance two translate 0 10 0 rotate 90 0 1 0 scale 2
+)", "test.scene");
+
+    // scale first, then rotate (1, 0, 0) onto (0, 0, -1), then translate
+    ASSERT_EQ(s.world.centers.size(), 2u);
+    const Body &a = s.world.centers[0], &b = s.world.centers[1];
+    EXPECT_NEAR(a.center.x, 0, 1e-9);
+    EXPECT_NEAR(a.center.y, 10, 1e-9);
+    EXPECT_NEAR(a.center.z, -2, 1e-9);
+    EXPECT_NEAR(a.radius, 1, 1e-9);
+    EXPECT_NEAR(b.center.x, 8, 1e-9);
+    EXPECT_NEAR(b.center.z, -2, 1e-9);
+    EXPECT_EQ(s.world.materials.size(), 1u);
+    EXPECT_EQ(s.world.materialIds[0], s.world.materialIds[1]);
+}
+
+TEST(SceneFile, Light) {
+    SceneDescription s = parseScene("light environment \"sky.exr\" scale 2\n"
+                                    "material m metal 1 1 1 0\nsphere m 0 0 0 1\n",
+                                    "scenes/test.scene");
+    EXPECT_EQ(s.envMap, "scenes/sky.exr");
+    EXPECT_EQ(s.envMapScale, 2);
+}
+
+TEST(SceneFile, Errors) {
+    // each message names the file and the line the mistake is on
+    struct {
+        const char *text, *message;
+    } bad[] = {
+        {"material m lambertian 1 1\nsphere m 0 0 0 1\n", "bad.scene:1:.*unexpected end of line"},
+        {"material m lambertian 1 1 x\nsphere m 0 0 0 1\n", "bad.scene:1:.*expected a number, got \"x\""},
+        {"material m lambertian 1 1 1\nsphere n 0 0 0 1\n", "bad.scene:2:.*undefined material \"n\""},
+        {"material m lambertian 1 1 1\nsphere m 0 0 0 -1\n", "bad.scene:2:.*sphere radius must be positive"},
+        {"material m lambertian 1 1 1\nsphere m 0 0 0 1 2\n", "bad.scene:2:.*unexpected \"2\""},
+        {"material m lambertian 1 1 1\nobject o\nsphere m 0 0 0 1\n",
+         "bad.scene:4:.*object \"o\" is missing its \"end\""},
+        {"material m lambertian 1 1 1\nobject o\ninstance o\nend\n", "bad.scene:3:.*object \"o\" instances itself"},
+        {"material m lambertian 1 1 1\ninstance nothing\n", "bad.scene:2:.*undefined object \"nothing\""},
+        {"triangle 0 0 0\n", "bad.scene:1:.*unknown directive \"triangle\""},
+        {"light environment \"unterminated\n", "bad.scene:1:.*unterminated string"},
+        {"", "bad.scene:1:.*scene has no spheres"},
+    };
+    for (const auto &b : bad)
+        EXPECT_DEATH(parseScene(b.text, "bad.scene"), b.message) << b.text;
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "benchmark/scenesuite.hpp"
+#include "options.hpp"
+
+namespace {
+
+BenchResult result(const std::string &name, double ms, double mrays, double rss, std::optional<double> mse) {
+    BenchResult r;
+    r.c = {name, "manyballs", 64, 36, 4, 1};
+    r.ok = true;
+    r.wallMs = {ms * 1.2, ms};
+    r.mraysPerSecond = mrays;
+    r.peakRssMiB = rss;
+    r.mse = mse;
+    return r;
+}
+
+const BenchComparison *find(const std::vector<BenchComparison> &cs, const std::string &metric) {
+    for (const BenchComparison &c : cs)
+        if (c.metric == metric)
+            return &c;
+    return nullptr;
+}
+
+} // namespace
+
+TEST(SceneSuite, WithinTolerance) {
+    auto cs = compareResults({result("a", 100, 10, 50, 1e-4)}, {result("a", 104, 9.6, 52, 1.04e-4)}, 0.05);
+    ASSERT_EQ(cs.size(), 4u);
+    for (const BenchComparison &c : cs)
+        EXPECT_FALSE(c.regression) << c.metric;
+    EXPECT_DOUBLE_EQ(find(cs, "wall_ms")->current, 104);  // the fastest run counts
+}
+
+TEST(SceneSuite, Regressions) {
+    auto cs = compareResults({result("a", 100, 10, 50, 1e-4)}, {result("a", 110, 9, 60, 2e-4)}, 0.05);
+    ASSERT_EQ(cs.size(), 4u);
+    for (const BenchComparison &c : cs)
+        EXPECT_TRUE(c.regression) << c.metric;
+}
+
+TEST(SceneSuite, MissingData) {
+    // unknown cases and cases without reference images are left out
+    auto cs = compareResults({result("a", 100, 10, 50, std::nullopt)},
+                             {result("a", 100, 10, 50, 0.5), result("b", 1, 1, 1, 0)}, 0.05);
+    EXPECT_EQ(cs.size(), 3u);
+    EXPECT_EQ(find(cs, "mse"), nullptr);
+
+    // an exact match stays exact, round-off is no regression
+    cs = compareResults({result("a", 100, 10, 50, 0)}, {result("a", 100, 10, 50, 1e-9)}, 0.05);
+    EXPECT_FALSE(find(cs, "mse")->regression);
+}
+
+class SceneSuiteTest : public testing::Test {
+protected:
+    void SetUp() override {
+        saved = Options;
+        Options = &options;
+        filename = testing::TempDir() + "scenesuite_test.json";
+    }
+    void TearDown() override {
+        Options = saved;
+        std::remove(filename.c_str());
+    }
+
+    RaytracerOptions options;
+    RaytracerOptions *saved = nullptr;
+    std::string filename;
+};
+
+TEST_F(SceneSuiteTest, RoundTrip) {
+    BenchResult failed;
+    failed.c = {"b\"quoted\"", "glassballs", 8, 8, 1, 7};
+    ASSERT_TRUE(writeBenchResults({result("a", 100, 12.5, 48.25, 3e-5), failed}, filename));
+    auto loaded = loadBenchResults(filename);
+    ASSERT_EQ(loaded.size(), 2u);
+
+    EXPECT_EQ(loaded[0].c.name, "a");
+    EXPECT_EQ(loaded[0].c.width, 64);
+    EXPECT_TRUE(loaded[0].ok);
+    ASSERT_EQ(loaded[0].wallMs.size(), 2u);
+    EXPECT_DOUBLE_EQ(loaded[0].wallMs[1], 100);
+    EXPECT_DOUBLE_EQ(loaded[0].mraysPerSecond, 12.5);
+    EXPECT_DOUBLE_EQ(loaded[0].peakRssMiB, 48.25);
+    ASSERT_TRUE(loaded[0].mse);
+    EXPECT_DOUBLE_EQ(*loaded[0].mse, 3e-5);
+
+    EXPECT_EQ(loaded[1].c.name, "b\"quoted\"");
+    EXPECT_EQ(loaded[1].c.seed, 7u);
+    EXPECT_FALSE(loaded[1].ok);
+    EXPECT_FALSE(loaded[1].mse);
+}
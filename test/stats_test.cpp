@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "util/stats.hpp"
+
+TEST(RayStats, Histograms) {
+    RayStats s;
+    s.addPathDepth(0);
+    s.addPathDepth(3);
+    s.addPathDepth(1000);
+    EXPECT_EQ(s.pathDepth[0], 1);
+    EXPECT_EQ(s.pathDepth[3], 1);
+    EXPECT_EQ(s.pathDepth[RayStats::depthBuckets - 1], 1);
+
+    s.addTests(0);
+    s.addTests(1);
+    s.addTests(484);
+    EXPECT_EQ(s.primitiveTests, 485);
+    EXPECT_EQ(s.testsPerRay[0], 1);
+    EXPECT_EQ(s.testsPerRay[1], 1);
+    EXPECT_EQ(s.testsPerRay[9], 1);  // 256-511
+}
+
+#ifndef NO_STATS
+TEST(RayStats, MergeThreads) {
+    RayStats::resetAll();
+    auto work = []() {
+        for (int i = 0; i < 1000; ++i) {
+            STAT_ADD(cameraRays, 1);
+            STAT_ADD(shadowRays, 2);
+            STAT_TESTS(10);
+            STAT_PATH_DEPTH(i % 4);
+        }
+    };
+    std::thread a(work), b(work);
+    work();
+    a.join();
+    b.join();
+
+    RayStats s = RayStats::mergeAll();
+    EXPECT_EQ(s.cameraRays, 3000);
+    EXPECT_EQ(s.shadowRays, 6000);
+    EXPECT_EQ(s.totalRays(), 9000);
+    EXPECT_EQ(s.primitiveTests, 30000);
+    EXPECT_EQ(s.testsPerRay[4], 3000);
+    EXPECT_EQ(s.pathDepth[2], 750);
+
+    RayStats::resetAll();
+    EXPECT_EQ(RayStats::mergeAll().totalRays(), 0);
+}
+#endif
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "render/tiles.hpp"
+
+static void ExpectExactCover(const std::vector<Bounds2<int>> &tiles, int W, int H) {
+    std::vector<int> covered(W * H, 0);
+    for (const auto &t : tiles) {
+        ASSERT_GE(t.pMin.x, 0);
+        ASSERT_GE(t.pMin.y, 0);
+        ASSERT_LE(t.pMax.x, W);
+        ASSERT_LE(t.pMax.y, H);
+        for (int y = t.pMin.y; y < t.pMax.y; ++y)
+            for (int x = t.pMin.x; x < t.pMax.x; ++x)
+                ++covered[y * W + x];
+    }
+    for (int i = 0; i < W * H; ++i)
+        ASSERT_EQ(1, covered[i]) << "pixel (" << i % W << ", " << i / W << ")";
+}
+
+TEST(Tiles, EveryOrderCoversImageOnce) {
+    for (TileOrder order : {TileOrder::RowMajor, TileOrder::Hilbert, TileOrder::Spiral}) {
+        ExpectExactCover(makeTiles(800, 450, 32, order), 800, 450);
+        ExpectExactCover(makeTiles(37, 91, 16, order), 37, 91);
+        ExpectExactCover(makeTiles(5, 5, 32, order), 5, 5);
+    }
+}
+
+TEST(Tiles, TailSplittingKeepsCover) {
+    auto plain = makeTiles(800, 450, 32, TileOrder::Hilbert);
+    auto split = makeTiles(800, 450, 32, TileOrder::Hilbert, 16);
+
+    ExpectExactCover(split, 800, 450);
+    EXPECT_GT(split.size(), plain.size());
+    EXPECT_LE(split.size(), plain.size() + 3 * 16);
+
+    // the untouched head keeps its order
+    for (std::size_t i = 0; i < plain.size() - 16; ++i)
+        EXPECT_EQ(plain[i].pMin, split[i].pMin);
+}
+
+TEST(Tiles, HilbertNeighboursAreAdjacent) {
+    for (int n : {2, 4, 8, 16}) {
+        auto tiles = makeTiles(n * 10, n * 10, 10, TileOrder::Hilbert);
+        ASSERT_EQ(std::size_t(n * n), tiles.size());
+        for (std::size_t i = 1; i < tiles.size(); ++i) {
+            int dx = std::abs(tiles[i].pMin.x - tiles[i - 1].pMin.x);
+            int dy = std::abs(tiles[i].pMin.y - tiles[i - 1].pMin.y);
+            EXPECT_EQ(10, dx + dy) << "step " << i << " for n = " << n;
+        }
+    }
+}
+
+TEST(Tiles, SpiralStartsAtCenter) {
+    auto tiles = makeTiles(90, 90, 10, TileOrder::Spiral);
+    EXPECT_EQ(Point2<int>(40, 40), tiles.front().pMin);
+}
+
+TEST(Tiles, AdaptiveTileSize) {
+    EXPECT_EQ(32, adaptiveTileSize(1920, 1080, 32, 4));
+    EXPECT_EQ(16, adaptiveTileSize(400, 225, 32, 16));
+    EXPECT_EQ(8, adaptiveTileSize(64, 64, 32, 64));
+}
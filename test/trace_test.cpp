@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "util/json.hpp"
+#include "util/trace.hpp"
+
+static int count(const std::string &s, const std::string &what) {
+    int n = 0;
+    for (auto i = s.find(what); i != std::string::npos; i = s.find(what, i + 1))
+        ++n;
+    return n;
+}
+
+// the tracer is global and initialized once, so everything is checked in one test
+TEST(Trace, WriteJson) {
+    tracer.init(16);
+    {
+        TraceScope outer("outer");
+        TraceScope inner("inner", "io");
+        inner.arg("x", 3).arg("y", -4);
+    }
+
+    std::thread worker([]() {
+        tracer.nameThread("worker \"1\"\\");
+        for (int i = 0; i < 40; ++i)
+            TraceScope("busy").arg("i", i);
+    });
+    worker.join();
+
+    std::string filename = testing::TempDir() + "trace_test.json";
+    ASSERT_TRUE(tracer.write(filename));
+    std::stringstream ss;
+    ss << std::ifstream(filename).rdbuf();
+    std::string json = ss.str();
+    std::remove(filename.c_str());
+
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(json.substr(json.size() - 3), "]}\n");
+    EXPECT_EQ(count(json, "\"ph\":\"M\""), 4);
+    EXPECT_EQ(count(json, "\"name\":\"main\""), 1);
+    EXPECT_EQ(count(json, "\"name\":\"worker \\\"1\\\"\\\\\""), 1);
+    EXPECT_EQ(count(json, "\"args\":{\"x\":3,\"y\":-4}"), 1);
+    // the worker's ring holds the last 16 of its 40 events
+    EXPECT_EQ(count(json, "\"name\":\"busy\""), 16);
+    EXPECT_EQ(count(json, "\"args\":{\"i\":39}"), 1);
+    EXPECT_EQ(count(json, "\"args\":{\"i\":23}"), 0);
+    EXPECT_EQ(count(json, "\"ph\":\"X\""), 18);
+
+    // names are escaped, so the whole file parses
+    JsonValue doc = parseJson(json, filename);
+    ASSERT_TRUE(doc.find("traceEvents"));
+    EXPECT_EQ(doc.find("traceEvents")->items.size(), 22u);
+}